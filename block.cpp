@@ -0,0 +1,175 @@
+#include "block.h"
+#include "bus.h"
+#include <algorithm>
+#include <iomanip>
+
+// ============================================================
+//  FIM DE BLOCO – Instruções que podem desviar o fluxo
+// ============================================================
+static bool ends_block(uint8_t op)
+{
+    switch (op)
+    {
+    case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+    case OP_JAL: case OP_JALR:
+    case OP_ECALL: case OP_MRET: case OP_WFI: case OP_FENCE_I:
+    case OP_CSRRW: case OP_CSRRS: case OP_CSRRC:
+    case OP_CSRRWI: case OP_CSRRSI: case OP_CSRRCI:
+    case OP_ILLEGAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+BlockCache::BlockCache()
+    : epoch(0), translations(0), chained(0),
+      ram_size(MAIN_RAM_SIZE),
+      page_blocks((MAIN_RAM_SIZE + (1u << PAGE_SHIFT) - 1) >> PAGE_SHIFT),
+      has_garbage(false)
+{
+}
+
+void BlockCache::resize(uint32_t new_size)
+{
+    if (new_size == ram_size) return;
+    flush();
+    collect();
+    ram_size = new_size;
+    page_blocks.clear();
+    page_blocks.resize(((uint64_t)new_size + (1u << PAGE_SHIFT) - 1) >> PAGE_SHIFT);
+}
+
+// ============================================================
+//  TRADUÇÃO – Decodifica até o fim do bloco (ou da página)
+// ============================================================
+BasicBlock* BlockCache::translate(uint32_t pc, Bus& bus)
+{
+    uint32_t local = pc - MAIN_RAM_START;
+    if (local >= ram_size || (pc & 1)) return nullptr;
+
+    std::unique_ptr<BasicBlock> block(new BasicBlock());
+    block->start_pc = pc;
+    block->exec_count = 0;
+    block->valid = true;
+    block->native = nullptr;
+    block->jit_failed = false;
+    block->chain[0] = block->chain[1] = nullptr;
+    block->chain_epoch[0] = block->chain_epoch[1] = 0;
+
+    uint32_t page = local >> PAGE_SHIFT;
+    uint32_t addr = pc;
+    do {
+        uint32_t instr = bus.readHalf(addr);
+        if ((instr & 3) == 3) {
+            // Instrução de 32 bits cruzando o fim da página: fica para o
+            // próximo bloco (ou para o caminho comum, se for a primeira)
+            if (((addr + 2 - MAIN_RAM_START) >> PAGE_SHIFT) != page || addr + 2 - MAIN_RAM_START >= ram_size) {
+                if (block->instrs.empty()) return nullptr;
+                break;
+            }
+            instr |= (uint32_t)bus.readHalf(addr + 2) << 16;
+        }
+        DecodedInstr d = decode_instr(instr);
+        block->instrs.push_back(d);
+        addr += d.len;
+        if (ends_block(d.op)) break;
+    } while (block->instrs.size() < MAX_BLOCK_INSTRS &&
+             ((addr - MAIN_RAM_START) >> PAGE_SHIFT) == page &&
+             addr - MAIN_RAM_START < ram_size);
+    block->end_pc = addr;
+
+    BasicBlock* raw = block.get();
+    storage.push_back(std::move(block));
+    blocks[pc] = raw;
+    page_blocks[page].push_back(raw);
+    translations++;
+    return raw;
+}
+
+// ============================================================
+//  INVALIDAÇÃO
+// ============================================================
+void BlockCache::retire(BasicBlock* block)
+{
+    block->valid = false;
+    blocks.erase(block->start_pc);
+    has_garbage = true;
+}
+
+void BlockCache::invalidate_range(uint32_t addr)
+{
+    std::vector<BasicBlock*>& list = page_blocks[(addr - MAIN_RAM_START) >> PAGE_SHIFT];
+    // Invalida por palavra: com RV32C um bloco pode começar no meio dela
+    uint32_t word = addr & ~3u;
+    bool changed = false;
+    for (size_t i = 0; i < list.size(); ) {
+        BasicBlock* block = list[i];
+        if (word + 4 > block->start_pc && word < block->end_pc) {
+            retire(block);
+            list[i] = list.back();
+            list.pop_back();
+            changed = true;
+        } else {
+            ++i;
+        }
+    }
+    if (changed) epoch++;
+}
+
+void BlockCache::invalidate_page(uint32_t addr)
+{
+    uint32_t local = addr - MAIN_RAM_START;
+    if (local >= ram_size || page_blocks[local >> PAGE_SHIFT].empty()) return;
+    for (BasicBlock* block : page_blocks[local >> PAGE_SHIFT]) retire(block);
+    page_blocks[local >> PAGE_SHIFT].clear();
+    epoch++;
+}
+
+void BlockCache::flush()
+{
+    for (auto& list : page_blocks) list.clear();
+    for (auto& entry : blocks) entry.second->valid = false;
+    blocks.clear();
+    has_garbage = !storage.empty();
+    epoch++;
+}
+
+void BlockCache::drop_native()
+{
+    for (auto& block : storage) {
+        block->native = nullptr;
+        block->jit_failed = false;
+    }
+}
+
+void BlockCache::collect()
+{
+    if (!has_garbage) return;
+    storage.erase(std::remove_if(storage.begin(), storage.end(),
+                                 [](const std::unique_ptr<BasicBlock>& b) { return !b->valid; }),
+                  storage.end());
+    has_garbage = false;
+}
+
+// ============================================================
+//  RELATÓRIO – Blocos mais executados (o "hot set")
+// ============================================================
+void BlockCache::print_hot(std::ostream& out, size_t count) const
+{
+    std::vector<const BasicBlock*> sorted;
+    for (const auto& block : storage) sorted.push_back(block.get());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const BasicBlock* a, const BasicBlock* b) { return a->exec_count > b->exec_count; });
+
+    out << "[BLOCOS] " << std::dec << translations << " traduzidos | "
+        << chained << " transições encadeadas\n";
+    for (size_t i = 0; i < sorted.size() && i < count; ++i) {
+        const BasicBlock* b = sorted[i];
+        if (b->exec_count == 0) break;
+        out << "  0x" << std::hex << std::setw(8) << std::setfill('0') << b->start_pc
+            << "-0x" << std::setw(8) << b->end_pc << std::dec << std::setfill(' ')
+            << " | " << std::setw(3) << b->instrs.size() << " instr | "
+            << b->exec_count << " execuções" << (b->native ? " [JIT]" : "") << "\n";
+    }
+}
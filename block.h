@@ -0,0 +1,98 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "icache.h" // DecodedInstr / OpId
+
+class Bus;
+struct JitContext;
+
+// Código nativo de um bloco: recebe os registradores e retorna o próximo PC
+typedef uint32_t (*JitFn)(uint32_t* regs, JitContext* ctx);
+
+/**
+ * @struct BasicBlock
+ * @brief Sequência de instruções já decodificadas que termina em um
+ * desvio, JAL, JALR ou instrução de SISTEMA.
+ */
+struct BasicBlock {
+    uint32_t start_pc;
+    uint32_t end_pc;                  // PC logo após a última instrução
+    std::vector<DecodedInstr> instrs; // A "superinstrução" traduzida
+    uint64_t exec_count;              // Quantas vezes o bloco foi executado
+    bool valid;                       // false após escrita no código / FENCE.I
+    JitFn native;                     // Código x86-64 (nullptr = interpretado)
+    bool jit_failed;                  // Já tentou compilar e não conseguiu
+
+    // Encadeamento: sucessores já resolvidos (alvo e/ou fall-through).
+    // Só são seguidos se 'chain_epoch' ainda for a época atual da cache.
+    BasicBlock* chain[2];
+    uint64_t chain_epoch[2];
+};
+
+/**
+ * @class BlockCache
+ * @brief Cache de blocos básicos traduzidos, indexada pelo PC inicial.
+ *
+ * Um bloco nunca cruza uma página de 4 KB, então cada página sabe quais
+ * blocos invalidar quando é escrita. Blocos invalidados não são liberados
+ * imediatamente (a CPU pode estar no meio de um deles): ficam marcados e
+ * são coletados em 'collect', chamado pela CPU entre blocos. Toda
+ * invalidação avança 'epoch', o que desfaz de uma vez todos os
+ * encadeamentos existentes.
+ */
+class BlockCache {
+public:
+    static const uint32_t PAGE_SHIFT = 12;
+    static const uint32_t MAX_BLOCK_INSTRS = 64;
+
+    uint64_t epoch;        // Avança a cada invalidação
+    uint64_t translations; // Blocos traduzidos
+    uint64_t chained;      // Transições feitas por encadeamento direto
+
+    BlockCache();
+
+    // Ajusta a cobertura ao tamanho da RAM (descarta tudo se mudar)
+    void resize(uint32_t ram_size);
+
+    BasicBlock* lookup(uint32_t pc) {
+        auto it = blocks.find(pc);
+        return it == blocks.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Traduz o bloco que começa em 'pc' (lendo pelo barramento).
+     * Retorna nullptr se o PC estiver fora da RAM.
+     */
+    BasicBlock* translate(uint32_t pc, Bus& bus);
+
+    // Chamado pelo Bus em cada escrita na RAM (código auto-modificável)
+    void invalidate(uint32_t addr) {
+        uint32_t local = addr - MAIN_RAM_START;
+        if (local < ram_size && !page_blocks[local >> PAGE_SHIFT].empty())
+            invalidate_range(addr);
+    }
+
+    void flush();   // FENCE.I: invalida todos os blocos
+    void drop_native(); // Buffer do JIT descartado: todos os blocos voltam a ser interpretados
+    void invalidate_page(uint32_t addr); // Invalida os blocos da página de 'addr'
+    void collect(); // Libera os blocos invalidados (fora da execução)
+
+    void print_hot(std::ostream& out, size_t count) const;
+
+private:
+    uint32_t ram_size; // Bytes cobertos a partir de MAIN_RAM_START
+    std::unordered_map<uint32_t, BasicBlock*> blocks; // Blocos válidos
+    std::vector<std::unique_ptr<BasicBlock>> storage; // Dono de todos os blocos
+    std::vector<std::vector<BasicBlock*>> page_blocks; // Blocos válidos por página
+    bool has_garbage;
+
+    void invalidate_range(uint32_t addr);
+    void retire(BasicBlock* block);
+};
+
+#endif // BLOCK_H
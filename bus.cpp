@@ -1,129 +1,209 @@
 #include "bus.h"
+#include "trace.h"
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
 
 Bus::Bus(MainRAM* ram, VRAM* vram, Peripherals* peripherals)
-    : ram(ram), vram(vram), peripherals(peripherals)
+    : peripherals(peripherals), icache(nullptr), bcache(nullptr), deadline(nullptr), ram(ram), vram(vram),
+      page_table(static_cast<PageEntry*>(std::calloc(PAGE_COUNT, sizeof(PageEntry)))),
+      owns_table(true)
+{
+    if (!page_table) {
+        std::cerr << "[Bus] ERRO FATAL: Sem memória para a tabela de páginas.\n";
+        std::abort();
+    }
+
+    mapDefault();
+    TRACE(TRACE_SUMMARY, "[Bus] Barramento conectado aos componentes de hardware.\n");
+}
+
+Bus::Bus(Bus& primary)
+    : peripherals(primary.peripherals), icache(nullptr), bcache(nullptr), deadline(nullptr), ram(primary.ram),
+      vram(primary.vram), page_table(primary.page_table), owns_table(false)
 {
-    std::cout << "[Bus] Barramento conectado aos componentes de hardware.\n";
+}
+
+Bus::~Bus()
+{
+    if (owns_table) std::free(page_table);
 }
 
 // ============================================================
-//  LER UM BYTE DO ENDEREÇO GLOBAL
+//  MAPEAMENTO DE PÁGINAS
 // ============================================================
-uint8_t Bus::readByte(uint32_t addr) {
-    // Periféricos
-    if (addr >= PERIPHERALS_START && addr <= PERIPHERALS_END) {
-        uint32_t local = addr - PERIPHERALS_START;
-        return peripherals->readByte(local);
+void Bus::mapDefault()
+{
+    // A ordem importa: os Periféricos ficam DENTRO da faixa da RAM e são
+    // mapeados por último, então a página do 'tohost' é sempre MMIO.
+    mapRam(MAIN_RAM_START, ram->size(), ram->data());
+    mapMmio(PERIPHERALS_START, PERIPHERALS_SIZE, peripherals);
+    mapMmio(CLINT_START, CLINT_SIZE, &peripherals->clint);
+    mapMmio(UART_START, UART_SIZE, &peripherals->uart);
+    // VRAM tem tamanho 0 nesta configuração: nenhuma página
+}
+
+void Bus::mapRam(uint32_t base, uint32_t size, uint8_t* host)
+{
+    if ((base & PAGE_MASK) || (size & PAGE_MASK)) {
+        log_err() << "[Bus] ERRO: Mapeamento de RAM não alinhado a 4 KB (0x"
+                  << std::hex << base << ", 0x" << size << std::dec << ")\n";
+        return;
     }
-    // RAM Principal
-    else if (addr >= MAIN_RAM_START && addr <= MAIN_RAM_END) {
-        uint32_t local = addr - MAIN_RAM_START;
-        return ram->readByte(local);
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        PageEntry& e = page_table[(base + off) >> PAGE_SHIFT];
+        e.host = host + off;
+        e.device = nullptr;
+        e.device_base = 0;
+        e.ram_page = (uint32_t)((host + off - ram->data()) >> PAGE_SHIFT);
     }
-    // VRAM
-    else if (addr >= VRAM_START && addr <= VRAM_END) {
-        return 0; // VRAM é um stub de leitura
+}
+
+void Bus::mapMmio(uint32_t base, uint32_t size, MmioDevice* device)
+{
+    if ((base & PAGE_MASK) || (size & PAGE_MASK)) {
+        log_err() << "[Bus] ERRO: Mapeamento MMIO não alinhado a 4 KB (0x"
+                  << std::hex << base << ", 0x" << size << std::dec << ")\n";
+        return;
     }
-    // Endereço Inválido
-    else {
-        std::cerr << "[Bus] ERRO: Leitura de Byte em endereço inválido 0x"
-                  << std::hex << addr << std::dec << std::endl;
-        return 0;
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        PageEntry& e = page_table[(base + off) >> PAGE_SHIFT];
+        e.host = nullptr;
+        e.device = device;
+        e.device_base = base;
+        e.ram_page = 0;
     }
 }
 
 // ============================================================
-//  ESCREVER UM BYTE NO ENDEREÇO GLOBAL
+//  LEITURA FORA DO CAMINHO RÁPIDO
 // ============================================================
-void Bus::writeByte(uint32_t addr, uint8_t data) {
-    // Periféricos
-    if (addr >= PERIPHERALS_START && addr <= PERIPHERALS_END) {
-        uint32_t local = addr - PERIPHERALS_START;
-        peripherals->writeByte(local, data);
-    }
-    // RAM Principal
-    else if (addr >= MAIN_RAM_START && addr <= MAIN_RAM_END) {
-        uint32_t local = addr - MAIN_RAM_START;
-        ram->writeByte(local, data);
+static const char* access_name(uint32_t size)
+{
+    return size == 1 ? "Byte" : size == 2 ? "Meia-palavra" : "Palavra";
+}
+
+uint32_t Bus::readSlow(uint32_t addr, uint32_t size) {
+    const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+
+    // Cruza a fronteira da página: byte a byte, cada um com seu roteamento
+    // (Little-Endian: LSB em addr)
+    if ((addr & PAGE_MASK) > PAGE_SIZE - size) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < size; i++)
+            value |= (uint32_t)readByte(addr + i) << (8 * i);
+        return value;
     }
-    // VRAM
-    else if (addr >= VRAM_START && addr <= VRAM_END) {
-        // VRAM é um stub de escrita
+    // Periférico mapeado
+    if (e.device) {
+        return e.device->mmioRead(addr - e.device_base, size);
     }
     // Endereço Inválido
-    else {
-        std::cerr << "[Bus] ERRO: Escrita de Byte em endereço inválido 0x"
-                  << std::hex << addr << std::dec << std::endl;
-    }
+    log_err() << "[Bus] ERRO: Leitura de " << access_name(size) << " em endereço inválido 0x"
+              << std::hex << addr << std::dec << std::endl;
+    return 0;
 }
 
 // ============================================================
-//  LEITURA DE PALAVRA (32 bits) EM LITTLE-ENDIAN (Corrigida)
+//  ESCRITA FORA DO CAMINHO RÁPIDO
 // ============================================================
-uint32_t Bus::readWord(uint32_t addr) {
-
-    // Periféricos (Acesso rápido)
-    if (addr >= PERIPHERALS_START && addr <= PERIPHERALS_END) {
-        uint32_t local = addr - PERIPHERALS_START;
-        return peripherals->readWord(local);
-    }
-    // RAM Principal (Montagem byte-a-byte, chamando readByte para roteamento)
-    else if (addr >= MAIN_RAM_START && addr <= MAIN_RAM_END) {
+void Bus::writeSlow(uint32_t addr, uint32_t data, uint32_t size) {
+    const PageEntry& e = page_table[addr >> PAGE_SHIFT];
 
-        // 🛑 CRÍTICO: Verifica se o acesso de 4 bytes excede o final da RAM
-        if (addr + 3 > MAIN_RAM_END) {
-            std::cerr << "[Bus] ERRO DE LIMITE: Leitura de palavra 0x" << std::hex << addr
-                      << " excede o fim da RAM (Max: 0x" << MAIN_RAM_END << ")!\n";
-            return 0; // Retorna 0 (simulando falha de leitura ou trap)
-        }
-
-        // Little-Endian: LSB em addr
-        uint32_t value = 0;
-        value |= readByte(addr);
-        value |= (uint32_t)readByte(addr + 1) << 8;
-        value |= (uint32_t)readByte(addr + 2) << 16;
-        value |= (uint32_t)readByte(addr + 3) << 24; // MSB
-        return value;
+    // Cruza a fronteira da página: byte a byte (Little-Endian)
+    if ((addr & PAGE_MASK) > PAGE_SIZE - size) {
+        for (uint32_t i = 0; i < size; i++)
+            writeByte(addr + i, (data >> (8 * i)) & 0xFF);
+        return;
     }
-    // VRAM e Endereços Inválidos (Retorna 0 ou reporta erro)
-    else {
-        std::cerr << "[Bus] ERRO: Leitura de Palavra em endereço inválido 0x"
-                  << std::hex << addr << std::dec << std::endl;
-        return 0;
+    // Periférico mapeado
+    if (e.device) {
+        e.device->mmioWrite(addr - e.device_base, data, size);
+        if (deadline && e.device->serviceOnWrite()) *deadline = 0;
+        return;
     }
+    // Endereço Inválido
+    log_err() << "[Bus] ERRO: Escrita de " << access_name(size) << " em endereço inválido 0x"
+              << std::hex << addr << std::dec << std::endl;
 }
 
 // ============================================================
-//  ESCRITA DE PALAVRA (32 bits) EM LITTLE-ENDIAN (Corrigida)
+//  ATÔMICAS (RV32A)
 // ============================================================
-void Bus::writeWord(uint32_t addr, uint32_t data) {
+// Novo valor da palavra para cada AMO ('old' e 'value' no formato do guest)
+static uint32_t amo_result(uint8_t op, uint32_t old, uint32_t value)
+{
+    switch (op)
+    {
+    case OP_AMOSWAP_W: return value;
+    case OP_AMOADD_W:  return old + value;
+    case OP_AMOXOR_W:  return old ^ value;
+    case OP_AMOAND_W:  return old & value;
+    case OP_AMOOR_W:   return old | value;
+    case OP_AMOMIN_W:  return (int32_t)old < (int32_t)value ? old : value;
+    case OP_AMOMAX_W:  return (int32_t)old > (int32_t)value ? old : value;
+    case OP_AMOMINU_W: return old < value ? old : value;
+    case OP_AMOMAXU_W: return old > value ? old : value;
+    default:           return old;
+    }
+}
+
+uint32_t Bus::loadAtomic(uint32_t addr)
+{
+    uint32_t* p = atomicTarget(addr);
+    if (!p) return 0; // Ver isAtomicAccess
+    uint32_t v = __atomic_load_n(p, __ATOMIC_SEQ_CST);
+    return load_le32(reinterpret_cast<const uint8_t*>(&v));
+}
 
-    // Periféricos (Acesso rápido)
-    if (addr >= PERIPHERALS_START && addr <= PERIPHERALS_END) {
-        uint32_t local = addr - PERIPHERALS_START;
-        peripherals->writeWord(local, data);
+uint32_t Bus::amoWord(uint32_t addr, uint8_t op, uint32_t value)
+{
+    uint32_t* p = atomicTarget(addr);
+    if (!p) return 0; // Ver isAtomicAccess
+
+    uint32_t old;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Host little-endian: as operações com instrução própria no host
+    switch (op)
+    {
+    case OP_AMOSWAP_W: old = __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST); break;
+    case OP_AMOADD_W:  old = __atomic_fetch_add(p, value, __ATOMIC_SEQ_CST); break;
+    case OP_AMOXOR_W:  old = __atomic_fetch_xor(p, value, __ATOMIC_SEQ_CST); break;
+    case OP_AMOAND_W:  old = __atomic_fetch_and(p, value, __ATOMIC_SEQ_CST); break;
+    case OP_AMOOR_W:   old = __atomic_fetch_or(p, value, __ATOMIC_SEQ_CST); break;
+    default:
+    {
+        // MIN/MAX: laço de CAS ('old' é recarregado quando o CAS falha)
+        old = __atomic_load_n(p, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(p, &old, amo_result(op, old, value), true,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {}
+        break;
     }
-    // RAM Principal (Desmontagem byte-a-byte, chamando writeByte para roteamento)
-    else if (addr >= MAIN_RAM_START && addr <= MAIN_RAM_END) {
-
-        // 🛑 CRÍTICO: Verifica se o acesso de 4 bytes excede o final da RAM
-        if (addr + 3 > MAIN_RAM_END) {
-            std::cerr << "[Bus] ERRO DE LIMITE: Escrita de palavra 0x" << std::hex << addr
-                      << " excede o fim da RAM (Max: 0x" << MAIN_RAM_END << ")!\n";
-            return;
-        }
-
-        // Little-Endian: LSB em addr
-        writeByte(addr, data & 0xFF);
-        writeByte(addr + 1, (data >> 8) & 0xFF);
-        writeByte(addr + 2, (data >> 16) & 0xFF);
-        writeByte(addr + 3, (data >> 24) & 0xFF); // MSB
     }
-    // VRAM e Endereços Inválidos (reporta erro)
-    else {
-        std::cerr << "[Bus] ERRO: Escrita de Palavra em endereço inválido 0x"
-                  << std::hex << addr << std::dec << std::endl;
+#else
+    // Host big-endian: a palavra do guest está invertida, tudo vira CAS
+    uint32_t raw = __atomic_load_n(p, __ATOMIC_RELAXED);
+    for (;;) {
+        old = __builtin_bswap32(raw);
+        uint32_t next = __builtin_bswap32(amo_result(op, old, value));
+        if (__atomic_compare_exchange_n(p, &raw, next, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) break;
     }
+#endif
+    atomicWritten(addr);
+    return old;
+}
+
+bool Bus::casWord(uint32_t addr, uint32_t expected, uint32_t desired)
+{
+    uint32_t* p = atomicTarget(addr);
+    if (!p) return false; // Ver isAtomicAccess
+    uint32_t want = expected, next = desired;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    want = __builtin_bswap32(want);
+    next = __builtin_bswap32(next);
+#endif
+    if (!__atomic_compare_exchange_n(p, &want, next, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        return false;
+    atomicWritten(addr);
+    return true;
 }
@@ -2,32 +2,211 @@
 #define BUS_H
 
 #include <cstdint>
+#include <cstring>
 #include <iostream>
-#include "ram.h" // Contm MainRAM, VRAM e Peripherals
+#include "ram.h" // Contém MainRAM, VRAM e Peripherals
+#include "mmio.h"
+#include "icache.h"
+#include "block.h"
 
 /**
  * @class Bus
  * @brief Gerencia o roteamento de leitura/escrita entre a CPU e os
- * diferentes componentes de memria (MainRAM, VRAM, Perifricos).
+ * diferentes componentes de memória (MainRAM, VRAM, Periféricos).
+ *
+ * O roteamento é uma tabela de páginas de 4 KB sobre todo o espaço de 32
+ * bits: cada página aponta para a memória do host (RAM) ou para um
+ * dispositivo MMIO, ou não está mapeada. Um acesso à RAM que não cruza a
+ * página é um deslocamento + uma leitura da tabela + um 'memcpy'
+ * little-endian (as escritas marcam ainda a página como suja na MainRAM). Todo o resto (MMIO, páginas cruzadas, endereços
+ * inválidos) cai nas funções '...Slow' de bus.cpp.
+ *
+ * Mapeamentos sobrepostos: o último 'mapRam'/'mapMmio' vence. O
+ * construtor mapeia a MainRAM e depois os Periféricos, então a página do
+ * 'tohost' (0x80001000) é sempre MMIO, mesmo estando dentro da RAM. O
+ * CLINT e a UART dos Periféricos ficam em CLINT_START e UART_START, fora
+ * da RAM.
  */
 class Bus {
 public:
+    static const uint32_t PAGE_SHIFT = 12;
+    static const uint32_t PAGE_SIZE  = 1u << PAGE_SHIFT;
+    static const uint32_t PAGE_MASK  = PAGE_SIZE - 1;
+    static const uint32_t PAGE_COUNT = 1u << (32 - PAGE_SHIFT);
+
     Bus(MainRAM* ram, VRAM* vram, Peripherals* peripherals);
+    // Porta de outro hart (SMP): mesma tabela de páginas e dispositivos de
+    // 'primary'; só as caches invalidadas pelas escritas são próprias
+    explicit Bus(Bus& primary);
+    ~Bus();
+
+    // Mapeia [base, base + size) (alinhados a 4 KB) sobre o que já existir.
+    // 'host' deve apontar para dentro da MainRAM (as escritas marcam as
+    // páginas sujas dela).
+    void mapRam(uint32_t base, uint32_t size, uint8_t* host);
+    void mapMmio(uint32_t base, uint32_t size, MmioDevice* device);
+    // Mapa do construtor (RAM + Periféricos), desfazendo remapeamentos
+    void mapDefault();
+
+    uint32_t ramSize() const { return ram->size(); }
+
+    // Acesso de 'size' bytes atendido direto pela RAM (sem MMIO nem
+    // cruzar a página): ler não tem efeito fora do hart
+    bool isRamAccess(uint32_t addr, uint32_t size) const {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        return e.host && (addr & PAGE_MASK) <= PAGE_SIZE - size;
+    }
+
+    uint8_t readByte(uint32_t addr) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host) return e.host[addr & PAGE_MASK];
+        return readSlow(addr, 1);
+    }
+
+    uint16_t readHalf(uint32_t addr) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host && (addr & PAGE_MASK) <= PAGE_SIZE - 2) return load_le16(e.host + (addr & PAGE_MASK));
+        return readSlow(addr, 2);
+    }
+
+    uint32_t readWord(uint32_t addr) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host && (addr & PAGE_MASK) <= PAGE_SIZE - 4) return load_le32(e.host + (addr & PAGE_MASK));
+        return readSlow(addr, 4);
+    }
+
+    void writeByte(uint32_t addr, uint8_t data) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host) {
+            e.host[addr & PAGE_MASK] = data;
+            ram->markDirty(e.ram_page);
+            invalidate_code(addr);
+        } else {
+            writeSlow(addr, data, 1);
+        }
+    }
+
+    void writeHalf(uint32_t addr, uint16_t data) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host && (addr & PAGE_MASK) <= PAGE_SIZE - 2) {
+            store_le16(e.host + (addr & PAGE_MASK), data);
+            ram->markDirty(e.ram_page);
+            invalidate_code(addr);
+            if ((addr & 3) == 3) invalidate_code(addr + 1); // Cruza a palavra
+        } else {
+            writeSlow(addr, data, 2);
+        }
+    }
+
+    void writeWord(uint32_t addr, uint32_t data) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (e.host && (addr & PAGE_MASK) <= PAGE_SIZE - 4) {
+            store_le32(e.host + (addr & PAGE_MASK), data);
+            ram->markDirty(e.ram_page);
+            invalidate_code(addr);
+            if (addr & 3) invalidate_code(addr + 3); // Desalinhado: duas palavras
+        } else {
+            writeSlow(addr, data, 4);
+        }
+    }
 
-    uint8_t   readByte(uint32_t addr);
-    void      writeByte(uint32_t addr, uint8_t data);
-    uint32_t  readWord(uint32_t addr);
-    void      writeWord(uint32_t addr, uint32_t data);
+    // ====================================================================
+    //  RV32A: atômicas numa palavra alinhada da RAM, com as atômicas do
+    //  host direto na memória, sem trava, então valem entre harts. Em MMIO
+    //  ou desalinhadas não há como garantir a atomicidade: a CPU confere
+    //  'isAtomicAccess' antes e para o hart (as funções abaixo não acessam
+    //  nada nesse caso).
+    // ====================================================================
+    bool isAtomicAccess(uint32_t addr) { return atomicTarget(addr) != nullptr; }
+    uint32_t loadAtomic(uint32_t addr);                       // LR.W
+    uint32_t amoWord(uint32_t addr, uint8_t op, uint32_t value); // OP_AMO*_W; retorna o valor antigo
+    bool casWord(uint32_t addr, uint32_t expected, uint32_t desired); // SC.W
 
     // ====================================================================
-    //  Permite que a CPU acesse o mdulo de Perifricos para checar 'tohost'
+    //  Permite que a CPU acesse o módulo de Periféricos para checar 'tohost'
     // ====================================================================
     Peripherals* peripherals;
 
+    // Cache de decodificação da CPU (invalidada nas escritas na RAM)
+    DecodeCache* icache;
+    BlockCache* bcache; // Idem para os blocos básicos traduzidos
+
+    // Fim da linha reta do motor da CPU (CPU::deadline). Uma escrita em
+    // MMIO o zera: a CPU atende os dispositivos (tohost, CLINT) logo
+    // depois da instrução que escreveu (a UART não precisa: ver
+    // MmioDevice::serviceOnWrite).
+    int* deadline;
+    bool serviceRequested() const { return deadline && *deadline == 0; }
+
 private:
+    /**
+     * @struct PageEntry
+     * @brief Destino de uma página de 4 KB. 'host' e 'device' nunca estão
+     * ambos preenchidos; os dois nulos = página não mapeada.
+     */
+    struct PageEntry {
+        uint8_t* host;        // RAM: início da página na memória do host
+        MmioDevice* device;   // MMIO: dispositivo que atende a página
+        uint32_t device_base; // Endereço onde o mapeamento do dispositivo começa
+        uint32_t ram_page;    // RAM: número da página na MainRAM (páginas sujas)
+    };
+
     MainRAM* ram;
     VRAM* vram;
     // Peripherals* peripherals; // Mantido em 'public'
+    PageEntry* page_table; // PAGE_COUNT entradas (calloc: páginas zeradas sob demanda)
+    bool owns_table;       // false: porta de outro hart (a tabela é do Bus principal)
+
+    Bus(const Bus&) = delete;
+    Bus& operator=(const Bus&) = delete;
+
+    void invalidate_code(uint32_t addr) {
+        if (icache) icache->invalidate(addr);
+        if (bcache) bcache->invalidate(addr);
+    }
+
+    // Acesso little-endian à memória do host (memcpy vira um único mov)
+    static uint16_t load_le16(const uint8_t* p) {
+        uint16_t v; std::memcpy(&v, p, 2);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap16(v);
+#endif
+        return v;
+    }
+    static uint32_t load_le32(const uint8_t* p) {
+        uint32_t v; std::memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+    static void store_le16(uint8_t* p, uint16_t v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap16(v);
+#endif
+        std::memcpy(p, &v, 2);
+    }
+    static void store_le32(uint8_t* p, uint32_t v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        std::memcpy(p, &v, 4);
+    }
+
+    // Palavra alinhada na RAM do host (alvo das atômicas) ou nullptr
+    uint32_t* atomicTarget(uint32_t addr) {
+        const PageEntry& e = page_table[addr >> PAGE_SHIFT];
+        if (!e.host || (addr & 3)) return nullptr;
+        return reinterpret_cast<uint32_t*>(e.host + (addr & PAGE_MASK));
+    }
+    void atomicWritten(uint32_t addr) {
+        ram->markDirty(page_table[addr >> PAGE_SHIFT].ram_page);
+        invalidate_code(addr);
+    }
+
+    // MMIO, acessos que cruzam página e endereços não mapeados
+    uint32_t readSlow(uint32_t addr, uint32_t size);
+    void     writeSlow(uint32_t addr, uint32_t data, uint32_t size);
 };
 
 #endif // BUS_H
@@ -0,0 +1,77 @@
+#include "clint.h"
+
+Clint::Clint()
+{
+    reset();
+}
+
+void Clint::reset()
+{
+    mtime = 0;
+    for (uint32_t h = 0; h < MAX_HARTS; ++h) {
+        mtimecmp[h] = ~0ull;
+        msip[h] = 0;
+        hart_wake[h] = hart_ipi_wake[h] = ~0ull;
+    }
+    mtime_generation = 0;
+}
+
+// Metade de um registrador de 64 bits ('high' = palavra de cima)
+static uint32_t half_of(uint64_t value, bool high)
+{
+    return high ? (uint32_t)(value >> 32) : (uint32_t)value;
+}
+
+static uint64_t with_half(uint64_t value, uint32_t data, bool high)
+{
+    if (high) return (value & 0xFFFFFFFFull) | ((uint64_t)data << 32);
+    return (value & ~0xFFFFFFFFull) | data;
+}
+
+uint32_t Clint::readWord(uint32_t offset)
+{
+    if (offset >= MTIME_OFFSET && offset < MTIME_OFFSET + 8)
+        return half_of(mtime, offset & 4);
+    if (offset >= MTIMECMP_BASE && offset < MTIMECMP_BASE + 8 * MAX_HARTS)
+        return half_of(mtimecmp[(offset - MTIMECMP_BASE) >> 3], offset & 4);
+    if (offset < MSIP_BASE + 4 * MAX_HARTS)
+        return msip[offset >> 2];
+    return 0;
+}
+
+void Clint::writeWord(uint32_t offset, uint32_t data)
+{
+    if (offset >= MTIME_OFFSET && offset < MTIME_OFFSET + 8) {
+        mtime = with_half(mtime, data, offset & 4);
+        mtime_generation++;
+    } else if (offset >= MTIMECMP_BASE && offset < MTIMECMP_BASE + 8 * MAX_HARTS) {
+        std::atomic<uint64_t>& cmp = mtimecmp[(offset - MTIMECMP_BASE) >> 3];
+        cmp = with_half(cmp, data, offset & 4);
+    } else if (offset < MSIP_BASE + 4 * MAX_HARTS) {
+        msip[offset >> 2] = data & 1;
+    }
+}
+
+// ============================================================
+//  INTERFACE MMIO
+// ============================================================
+// Os registradores são palavras; bytes e meias palavras leem/alteram a
+// palavra que os contém
+uint32_t Clint::mmioRead(uint32_t offset, uint32_t size)
+{
+    uint32_t shift = (offset & 3) * 8;
+    uint32_t word = readWord(offset & ~3u) >> shift;
+    return size == 4 ? word : word & ((1u << (size * 8)) - 1);
+}
+
+void Clint::mmioWrite(uint32_t offset, uint32_t data, uint32_t size)
+{
+    if (size == 4 && !(offset & 3)) {
+        writeWord(offset, data);
+        return;
+    }
+    uint32_t shift = (offset & 3) * 8;
+    uint32_t mask = (size == 4 ? 0xFFFFFFFFu : (1u << (size * 8)) - 1) << shift;
+    uint32_t word = readWord(offset & ~3u);
+    writeWord(offset & ~3u, (word & ~mask) | ((data << shift) & mask));
+}
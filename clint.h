@@ -0,0 +1,61 @@
+#ifndef CLINT_H
+#define CLINT_H
+
+#include <atomic>
+#include <cstdint>
+#include "mmio.h"
+
+// CLINT no endereço usado pelo SiFive/QEMU 'virt' (16 páginas de 4 KB)
+const uint32_t CLINT_START = 0x02000000;
+const uint32_t CLINT_SIZE  = 0x10000;
+
+// Bits de mip/mie (interrupções do modo máquina)
+const uint32_t MIP_MSIP = 1u << 3; // Software (msip do CLINT)
+const uint32_t MIP_MTIP = 1u << 7; // Timer (mtime >= mtimecmp)
+
+/**
+ * @class Clint
+ * @brief Core-Local Interruptor: 'msip' (interrupção de software) e
+ * 'mtimecmp' (timer) de cada hart, e o 'mtime' compartilhado.
+ *
+ *   0x0000 + 4 * hart   msip     (só o bit 0)
+ *   0x4000 + 8 * hart   mtimecmp (64 bits, duas palavras)
+ *   0xBFF8              mtime    (64 bits, duas palavras)
+ *
+ * O CLINT não tem relógio próprio: um ciclo da CPU = um tick, e o tempo
+ * de cada hart são os próprios ciclos mais um deslocamento (CPU::time_now).
+ * O hart 0 publica o seu tempo em 'mtime' a cada ponto de serviço do
+ * agendador (CPU::service_events), então uma leitura de 'mtime' por MMIO
+ * vê o tempo do último ponto de serviço, como no spike. Uma gravação do
+ * guest em 'mtime' acerta o deslocamento de todos os harts.
+ */
+class Clint : public MmioDevice {
+public:
+    static const uint32_t MAX_HARTS = 64;
+    static const uint32_t MSIP_BASE = 0x0000;
+    static const uint32_t MTIMECMP_BASE = 0x4000;
+    static const uint32_t MTIME_OFFSET = 0xBFF8;
+
+    std::atomic<uint64_t> mtime;
+    std::atomic<uint64_t> mtimecmp[MAX_HARTS]; // ~0 = timer desligado
+    std::atomic<uint32_t> msip[MAX_HARTS];
+    std::atomic<uint32_t> mtime_generation; // Conta as gravações do guest em 'mtime'
+    // Harts livres (--smp=free): a partir de que tempo cada hart pode
+    // agir sobre os outros (~0 = nunca). Rodando, é o tempo dele; parado
+    // em WFI, é o timer dele ('hart_wake') ou, se o 'msip' dele estiver
+    // ligado, o tempo em que uma IPI o acordou ('hart_ipi_wake')
+    std::atomic<uint64_t> hart_wake[MAX_HARTS];
+    std::atomic<uint64_t> hart_ipi_wake[MAX_HARTS];
+
+    Clint();
+    void reset();
+
+    uint32_t mmioRead(uint32_t offset, uint32_t size) override;
+    void mmioWrite(uint32_t offset, uint32_t data, uint32_t size) override;
+
+private:
+    uint32_t readWord(uint32_t offset);
+    void writeWord(uint32_t offset, uint32_t data);
+};
+
+#endif // CLINT_H
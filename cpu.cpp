@@ -1,20 +1,39 @@
 #include "cpu.h"
+#include "trace.h"
+#include "rv32m.h"
+#include "profile.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <string>
+#include <thread>
 
 // ============================================================
-//  CONSTRUTOR  Inicializa todos os registradores e PC
+//  CONSTRUTOR – Inicializa todos os registradores e PC
 // ============================================================
 CPU::CPU()
+{
+    reset();
+    engine = ENGINE_SWITCH;
+    jit_threshold = 50;
+    profiler = nullptr;
+    TRACE(TRACE_SUMMARY, "[CPU] CPU inicializada (Modo Compliance, PC=0x80000000)\n");
+}
+
+// ============================================================
+//  RESET – Estado de power-on (reaproveita a CPU para outro programa)
+// ============================================================
+void CPU::reset()
 {
     for (int i = 0; i < 32; ++i) regs[i] = 0;
     regs[0] = 0;
 
-    // Endereo inicial padro para testes de compliance
+    // Endereço inicial padrão para testes de compliance
     pc = 0x80000000;
 
-    // Inicializa todos os CSRs (Simplificado para M-Mode Bsico)
+    // Inicializa todos os CSRs (Simplificado para M-Mode Básico)
     mtvec = 0;
     mcause = 0;
     mstatus = 0;
@@ -27,41 +46,748 @@ CPU::CPU()
     satp = 0;
     mhartid = 0;
 
+    reservation_addr = reservation_value = 0;
+    reservation_valid = false;
+    atomics = 0;
+
+    cycle_base = idle_cycles = mcycle_offset = minstret_offset = 0;
+    for (int i = 0; i < HPM_EVENT_COUNT; ++i) hpm_events[i] = 0;
+    for (int i = 0; i < HPM_COUNTERS; ++i) {
+        mhpmevent[i] = HPM_EVENT_NONE;
+        hpm_offset[i] = 0;
+    }
+
     running = true;
     cycle_count = 0;
-    std::cout << "[CPU] CPU inicializada (Modo Compliance, PC=0x80000000)\n";
+    deadline = 0;
+    waiting = false;
+    time_offset = 0;
+    time_generation = 0;
+    interrupts = 0;
+    clint = nullptr;
+    hart_count = 1;
+    free_running = false;
+    infinite_loop = false;
+    spin_skipped = 0;
+    spin_pc = 0;
+    spin_backoff = 1;
+    spin_countdown = 0;
+    trace.clear();
+    trace_entry = trace.data();
+
+    // Nada decodificado/compilado vale para o próximo programa
+    icache.flush();
+    icache.hits = icache.misses = 0;
+    blocks.flush();
+    blocks.collect();
+    jit.reset();
 }
 
 void CPU::setPC(uint32_t new_pc)
 {
     pc = new_pc;
-    std::cout << "[CPU] PC ajustado manualmente para 0x"
-              << std::hex << std::setw(8) << std::setfill('0') << pc << std::dec << std::endl;
+    TRACE(TRACE_SUMMARY, "[CPU] PC ajustado manualmente para 0x"
+              << std::hex << std::setw(8) << std::setfill('0') << pc << std::dec << std::endl);
 }
 
 void CPU::run(Bus& bus, int max_cycles)
 {
     running = true;
-    cycle_count = 0;
-    std::cout << "---[ INCIO DA EXECUO RISC-V (Compliance) ]---\n";
+    restart_cycles();
+    resume(bus, max_cycles);
+}
+
+void CPU::resume(Bus& bus, int max_cycles)
+{
+    TRACE(TRACE_SUMMARY, "---[ INÍCIO DA EXECUÇÃO RISC-V (Compliance) ]---\n");
+    run_slice(bus, max_cycles);
+
+    if (cycle_count >= max_cycles)
+        TRACE(TRACE_SUMMARY, ">>> RESULTADO: TIMEOUT! (Limite de " << max_cycles << " ciclos atingido)\n");
+
+    TRACE(TRACE_SUMMARY, "[ICACHE] Acertos: " << std::dec << icache.hits << " | Faltas: " << icache.misses << "\n");
+    if constexpr (TRACE_LEVEL >= TRACE_SUMMARY) {
+        if (engine == ENGINE_BLOCKS || engine == ENGINE_JIT) blocks.print_hot(log_out(), 10);
+        if (engine == ENGINE_JIT)
+            log_out() << "[JIT] Blocos compilados: " << jit.compiled << " | Rejeitados: " << jit.rejected
+                      << " | Descartes do buffer: " << jit.flushes << "\n";
+    }
+    TRACE(TRACE_SUMMARY, "---[ FIM DA EXECUÇÃO RISC-V ]---\n");
+}
+
+void CPU::run_slice(Bus& bus, int max_cycles)
+{
+    icache.resize(bus.ramSize());
+    blocks.resize(bus.ramSize());
+    bus.icache = &icache; // Escritas na RAM invalidam as entradas decodificadas
+    bus.bcache = &blocks; // ... e os blocos básicos que as contêm
+    trace_entry = trace.data(); // O anel pode ter sido redimensionado
+    bus.deadline = &deadline;    // Escritas em MMIO forçam um ponto de serviço
+    clint = &bus.peripherals->clint;
+
+    // Linhas retas até 'deadline', intercaladas com os pontos de serviço
+    while (service_events(bus, max_cycles)) {
+        if (profiler)
+            run_profiled(bus);
+        else if (engine == ENGINE_THREADED)
+            run_threaded(bus);
+        else if (engine == ENGINE_BLOCKS || engine == ENGINE_JIT)
+            run_blocks(bus);
+        else
+            run_switch(bus);
+    }
+
+    bus.icache = nullptr;
+    bus.bcache = nullptr;
+    bus.deadline = nullptr;
+}
+
+// ============================================================
+//  AGENDADOR DE EVENTOS – Pontos de serviço entre as linhas retas
+// ============================================================
+// Atende o 'tohost' (fim ou chamada de sistema), a UART, o relógio do
+// CLINT, as interrupções pendentes e o WFI, e calcula o próximo 'deadline'. Devolve
+// false quando a execução deve parar (erro fatal, 'tohost' ou limite de
+// ciclos).
+bool CPU::service_events(Bus& bus, int max_cycles)
+{
+    if (bus.peripherals->requestPending()) bus.peripherals->serviceRequest(bus);
+    if (mhartid == 0) bus.peripherals->uart.service(cycles());
+    sync_clock();
+    for (;;) {
+        if (!running || bus.peripherals->simulation_should_halt || cycle_count >= max_cycles)
+            return false;
+
+        uint32_t pending = pending_interrupts() & mie;
+        if (waiting) {
+            if (!pending) {
+                // Avança o tempo direto até o evento
+                if (!wait_for_interrupt(max_cycles)) return false;
+                continue;
+            }
+            waiting = false; // WFI acorda mesmo com mstatus.MIE = 0
+            sync_clock();    // Volta a publicar o próprio tempo
+        }
+        if (pending && (mstatus & MSTATUS_MIE)) {
+            take_interrupt(pending);
+        } else if (!profiler && spin_probe_due()) {
+            // Com --profile o laço é executado: o perfil conta cada volta
+            uint64_t events[HPM_EVENT_COUNT];
+            uint32_t start = pc;
+            int before = cycle_count;
+            int length = probe_spin_loop(bus, max_cycles, events);
+            if (length) {
+                if (!skip_spin_loop(length, events, max_cycles)) return false;
+                continue;
+            }
+            if (cycle_count != before) {
+                // Executou instruções em vão (um laço comum, por exemplo)
+                spin_pc = start;
+                spin_backoff = std::min(spin_backoff * 2, SPIN_BACKOFF_MAX);
+                spin_countdown = spin_backoff;
+                continue; // Confere tudo de novo depois delas
+            }
+        }
+        schedule(max_cycles);
+        return true;
+    }
+}
+
+// Se o guest gravou 'mtime', o valor gravado vale a partir daqui; o
+// hart 0 publica o próprio tempo no 'mtime' do CLINT (leituras por MMIO).
+// Harts livres publicam também quando podem agir (ver 'others_time').
+void CPU::sync_clock()
+{
+    uint32_t generation = clint->mtime_generation;
+    if (generation != time_generation) {
+        time_generation = generation;
+        time_offset = clint->mtime - cycles();
+    }
+    if (mhartid == 0) clint->mtime = time_now();
+    if (free_running && mhartid < Clint::MAX_HARTS) {
+        uint64_t now = time_now();
+        clint->hart_wake[mhartid] = !waiting ? now : (mie & MIP_MTIP) ? clint->mtimecmp[mhartid].load() : ~0ull;
+        clint->hart_ipi_wake[mhartid] = (!waiting || (mie & MIP_MSIP)) ? now : ~0ull;
+    }
+}
+
+uint32_t CPU::pending_interrupts() const
+{
+    if (!clint || mhartid >= Clint::MAX_HARTS) return 0;
+    uint32_t pending = 0;
+    if (clint->msip[mhartid] & 1) pending |= MIP_MSIP;
+    if (time_now() >= clint->mtimecmp[mhartid]) pending |= MIP_MTIP;
+    return pending;
+}
+
+// Trap assíncrona: o software tem prioridade sobre o timer. Com
+// mtvec.MODE = 1 (vetorizado), salta para BASE + 4 * causa.
+void CPU::take_interrupt(uint32_t pending)
+{
+    uint32_t code = (pending & MIP_MSIP) ? 3 : 7;
+    uint32_t base = mtvec & ~3u;
+    uint32_t target = (mtvec & 1) ? base + 4 * code : base;
+    TRACE(TRACE_INSTR, "    -> INTERRUPÇÃO " << code << " | Trap para 0x" << std::hex << target << std::dec << "\n");
+    mepc = pc;
+    mcause = 0x80000000u | code;
+    mstatus = (mstatus & ~(MSTATUS_MIE | MSTATUS_MPIE)) | ((mstatus & MSTATUS_MIE) ? MSTATUS_MPIE : 0);
+    hpm_events[HPM_EVENT_TRAP]++;
+    interrupts++;
+    if (profiler) profiler->interrupt(target);
+    pc = target;
+}
+
+// Ciclos até o próximo evento que pode mudar o estado de um hart parado:
+// o limite, o timer deste hart (se 'timer') ou, para ver o 'msip', o
+// 'tohost' e a memória dos outros harts, SERVICE_INTERVAL ciclos
+int64_t CPU::cycles_to_event(int max_cycles, bool timer) const
+{
+    int64_t cycles = max_cycles - cycle_count;
+    if (hart_count > 1) cycles = std::min<int64_t>(cycles, SERVICE_INTERVAL);
+    if (timer) {
+        uint64_t now = time_now(), cmp = clint->mtimecmp[mhartid];
+        if (cmp <= now) return 0; // Já disparou (a sondagem pode ter passado dele)
+        if (cmp - now < (uint64_t)cycles) cycles = (int64_t)(cmp - now);
+    }
+    return cycles;
+}
+
+// Nada pode tirar o hart de onde está: para já, em vez de esgotar o limite
+void CPU::stop_forever(const char* what)
+{
+    TRACE(TRACE_SUMMARY, ">>> " << what << " sem saída em PC=0x" << std::hex << pc << std::dec
+              << " (ciclo " << cycle_count << "): nenhum evento pode acordar o hart\n");
+    infinite_loop = true;
+    running = false;
+}
+
+// Menor tempo a partir do qual outro hart livre pode agir (~0 = nenhum)
+uint64_t CPU::others_time() const
+{
+    uint64_t time = ~0ull;
+    for (uint32_t h = 0; h < hart_count && h < Clint::MAX_HARTS; ++h) {
+        if (h == mhartid) continue;
+        time = std::min<uint64_t>(time, clint->hart_wake[h]);
+        if (clint->msip[h] & 1) time = std::min<uint64_t>(time, clint->hart_ipi_wake[h]);
+    }
+    return time;
+}
+
+// Harts livres parados (WFI ou laço sem efeitos) não passam de 'slack'
+// ciclos além do tempo a partir do qual outro hart pode agir (escrever o
+// 'msip' ou a RAM deste): à frente de todos, o hart cede a thread do host
+// até eles andarem, em vez de gastar o próprio limite. Devolve 'cycles'
+// limitado.
+int64_t CPU::limit_to_others(int64_t cycles, uint64_t slack)
+{
+    if (!free_running) return cycles;
+    uint64_t now = time_now(), others = others_time();
+    if (others != ~0ull) others += slack;
+    if (others <= now) {
+        std::this_thread::yield();
+        return 0;
+    }
+    return others - now < (uint64_t)cycles ? (int64_t)(others - now) : cycles;
+}
+
+// WFI sem interrupção pendente: pula direto para o próximo evento. Os
+// ciclos parados contam no limite. false = nenhum evento pode acordá-lo.
+bool CPU::wait_for_interrupt(int max_cycles)
+{
+    bool timer = (mie & MIP_MTIP) && mhartid < Clint::MAX_HARTS && clint->mtimecmp[mhartid] != ~0ull;
+    if (hart_count == 1 && !timer) {
+        stop_forever("WFI");
+        return false;
+    }
+    int64_t skip = limit_to_others(cycles_to_event(max_cycles, timer), 0);
+    cycle_count += (int)skip;
+    idle_cycles += skip;
+    sync_clock();
+    return true;
+}
+
+// ============================================================
+//  LAÇOS SEM EFEITOS – "j ." e espera ativa por um valor da RAM
+// ============================================================
+// Num laço comum a sondagem falha sempre: depois de cada falha, as
+// sondagens perto do mesmo PC ficam cada vez mais espaçadas (até
+// SPIN_BACKOFF_MAX pontos de serviço); longe dele, voltam a ser imediatas.
+bool CPU::spin_probe_due()
+{
+    if (pc - spin_pc + 64 > 128) { // Fora de [spin_pc - 64, spin_pc + 64]
+        spin_backoff = 1;
+        spin_countdown = 0;
+    }
+    if (spin_countdown > 0) {
+        spin_countdown--;
+        return false;
+    }
+    return true;
+}
+
+// Executa uma volta do laço que passa pelo PC atual, só com instruções
+// sem efeito fora dos registradores (ULA, desvios, saltos e LOADs da
+// RAM). Se ela volta ao PC de partida com os mesmos
+// registradores, toda volta seguinte é igual enquanto a RAM não mudar, e
+// só outro hart ou uma interrupção tiram o hart dali. A primeira volta
+// pode só ter carregado os valores do laço: se os registradores mudaram,
+// tenta mais uma.
+// Devolve as instruções por volta (0 = não é um laço sem efeitos) e, em
+// 'events', os HpmEvent de uma volta.
+int CPU::probe_spin_loop(Bus& bus, int max_cycles, uint64_t* events)
+{
+    const uint32_t start = pc;
+    uint32_t before[32];
+    for (int turn = 0; turn < 2; ++turn) {
+        std::memcpy(before, regs, sizeof(regs));
+        for (int i = 0; i < HPM_EVENT_COUNT; ++i) events[i] = hpm_events[i];
+        int n = 0;
+        do {
+            if (++n > SPIN_PROBE_LIMIT || cycle_count >= max_cycles) return 0;
+            const DecodedInstr& d = fetch_decoded(bus);
+            bool pure = (d.op >= OP_ADDI && d.op <= OP_AUIPC) || (d.op >= OP_BEQ && d.op <= OP_JALR) ||
+                        d.op == OP_NOP;
+            if (d.op >= OP_LB && d.op <= OP_LHU) {
+                uint32_t size = d.op == OP_LW ? 4 : (d.op == OP_LH || d.op == OP_LHU) ? 2 : 1;
+                pure = bus.isRamAccess(regs[d.rs1] + d.imm, size);
+            }
+            if (!pure) {
+                pc -= d.len; // Não executada: o motor continua dela
+                return 0;
+            }
+            uint8_t rd = d.rd;
+            trace_begin(pc - d.len, d.raw);
+            execute(d, bus);
+            trace_result(regs[rd]);
+            cycle_count++;
+            regs[0] = 0;
+        } while (pc != start);
+
+        if (std::memcmp(before, regs, sizeof(regs)) == 0) {
+            for (int i = 0; i < HPM_EVENT_COUNT; ++i) events[i] = hpm_events[i] - events[i];
+            return n;
+        }
+    }
+    return 0;
+}
+
+// Laço sem efeitos confirmado: pula as voltas inteiras até o próximo
+// evento, como se tivessem sido executadas (minstret e os mhpmcounter
+// contam). false = nenhum evento pode tirá-lo do laço.
+bool CPU::skip_spin_loop(int length, const uint64_t* events, int max_cycles)
+{
+    bool timer = (mstatus & MSTATUS_MIE) && (mie & MIP_MTIP) && mhartid < Clint::MAX_HARTS &&
+                 clint->mtimecmp[mhartid] != ~0ull;
+    if (hart_count == 1 && !timer) {
+        stop_forever("Laço sem efeitos");
+        return false;
+    }
+    // A RAM que o laço lê pode já ter mudado sem que ele tenha visto: o
+    // hart continua publicando o próprio tempo e, com harts livres, pode
+    // ficar até SERVICE_INTERVAL ciclos à frente do mais atrasado (dois
+    // harts esperando um pelo outro se revezam até o limite)
+    int64_t turns = limit_to_others(cycles_to_event(max_cycles, timer), SERVICE_INTERVAL) / length;
+    if (turns == 0) return true; // Falta menos de uma volta: a próxima sondagem a executa
+    int64_t skipped = turns * length;
+    cycle_count += (int)skipped;
+    spin_skipped += skipped;
+    for (int i = 0; i < HPM_EVENT_COUNT; ++i) hpm_events[i] += turns * events[i];
+    if (EXEC_TRACE) {
+        TraceEntry* e = trace.next(pc | 1, (uint32_t)skipped); // Uma entrada para as voltas puladas
+        e->value = pc;
+        e->addr = TRACE_GROUP_SPIN;
+    }
+    sync_clock();
+    return true;
+}
+
+// Próximo 'deadline': o limite de ciclos, o timer deste hart (se puder
+// interromper) ou SERVICE_INTERVAL ciclos, o que vier primeiro
+void CPU::schedule(int max_cycles)
+{
+    int64_t limit = std::min<int64_t>(max_cycles, (int64_t)cycle_count + SERVICE_INTERVAL);
+    if ((mstatus & MSTATUS_MIE) && (mie & MIP_MTIP) && clint && mhartid < Clint::MAX_HARTS) {
+        uint64_t now = time_now(), cmp = clint->mtimecmp[mhartid];
+        if (cmp > now && cmp - now < (uint64_t)(limit - cycle_count)) limit = cycle_count + (int64_t)(cmp - now);
+    }
+    deadline = (int)limit;
+}
 
-    // O loop checa se a simulao deve parar via perifrico 'tohost'
-    while (running && cycle_count < max_cycles && !bus.peripherals->simulation_should_halt)
+// ============================================================
+//  RUN SWITCH – Motor de referência (fetch + switch no 'execute')
+// ============================================================
+void CPU::run_switch(Bus& bus)
+{
+    // 'tohost', erros e interrupções só são vistos no ponto de serviço:
+    // quem os causa zera 'deadline'
+    while (cycle_count < deadline)
     {
-        uint32_t instr = fetch(bus);
+        const DecodedInstr& instr = fetch_decoded(bus);
+        uint8_t rd = instr.rd; // 'instr' pode sumir num FENCE.I
+        trace_begin(pc - instr.len, instr.raw);
         execute(instr, bus);
+        trace_result(regs[rd]);
         cycle_count++;
         regs[0] = 0; // x0 deve ser sempre 0
     }
+}
 
-    if (cycle_count >= max_cycles)
-        std::cout << ">>> RESULTADO: TIMEOUT! (Limite de " << max_cycles << " ciclos atingido)\n";
+// ============================================================
+//  RUN PROFILED – Motor switch contando cada instrução (--profile)
+// ============================================================
+void CPU::run_profiled(Bus& bus)
+{
+    Profiler& prof = *profiler;
+    while (cycle_count < deadline)
+    {
+        const DecodedInstr& instr = fetch_decoded(bus);
+        DecodedInstr d = instr; // 'instr' pode sumir num FENCE.I
+        prof.count(pc - d.len, d);
+        trace_begin(pc - d.len, d.raw);
+        execute(d, bus);
+        trace_result(regs[d.rd]);
+        cycle_count++;
+        regs[0] = 0;
+        if (d.op >= OP_JAL && d.op <= OP_MRET) prof.transfer(d, pc);
+    }
+}
+
+// ============================================================
+//  RUN BLOCKS – Executa blocos básicos traduzidos e encadeados
+// ============================================================
+void CPU::run_blocks(Bus& bus)
+{
+    BasicBlock* block = nullptr; // Último bloco executado (origem do encadeamento)
+
+    // O código nativo não gera o log por instrução: com trace, só interpreta
+    const bool use_jit = (engine == ENGINE_JIT) && TRACE_LEVEL < TRACE_INSTR;
+
+    while (cycle_count < deadline)
+    {
+        // 1. Próximo bloco: segue o encadeamento se ele ainda for válido
+        BasicBlock* next = nullptr;
+        if (block) {
+            for (int i = 0; i < 2; ++i) {
+                if (block->chain[i] && block->chain_epoch[i] == blocks.epoch && block->chain[i]->start_pc == pc) {
+                    next = block->chain[i];
+                    blocks.chained++;
+                    break;
+                }
+            }
+        }
+
+        if (!next) {
+            next = blocks.lookup(pc);
+            if (!next) next = blocks.translate(pc, bus);
+            if (!next) {
+                // PC fora da RAM: executa uma instrução pelo caminho comum
+                const DecodedInstr& d = fetch_decoded(bus);
+                trace_begin(pc - d.len, d.raw);
+                execute(d, bus);
+                trace_result(regs[d.rd]);
+                cycle_count++;
+                regs[0] = 0;
+                block = nullptr;
+                continue;
+            }
+            // Encadeia o bloco anterior ao novo sucessor (slot livre ou o 2º)
+            if (block) {
+                int slot = (block->chain[0] && block->chain_epoch[0] == blocks.epoch) ? 1 : 0;
+                block->chain[slot] = next;
+                block->chain_epoch[slot] = blocks.epoch;
+            }
+            blocks.collect(); // Nenhum bloco em execução: libera os inválidos
+        }
+
+        block = next;
+        block->exec_count++;
+
+        // 2. Bloco quente: tenta compilar para x86-64 (uma única vez)
+        if (use_jit && !block->native && !block->jit_failed && block->exec_count >= (uint64_t)jit_threshold) {
+            block->native = jit.compile(*block);
+            if (!block->native && jit.full()) {
+                // Buffer cheio (código auto-modificável deixa muito código
+                // morto nele): descarta todo o código nativo e recompila
+                blocks.drop_native();
+                jit.flush();
+                block->native = jit.compile(*block);
+            }
+            block->jit_failed = (block->native == nullptr);
+        }
 
-    std::cout << "---[ FIM DA EXECUO RISC-V ]---\n";
+        // 3. Executa o bloco inteiro, saindo antes se o código for alterado
+        uint64_t epoch = blocks.epoch;
+        if (block->native && cycle_count + (int)block->instrs.size() <= deadline) {
+            uint32_t n = (uint32_t)block->instrs.size();
+            JitContext ctx = { &bus, &blocks, epoch, (uint32_t)(deadline - cycle_count), 0, hpm_events };
+            pc = block->native(regs, &ctx);
+            cycle_count += ctx.retired;
+            if (EXEC_TRACE) {
+                TraceEntry* e = trace.next(block->start_pc | 1, ctx.retired); // Bloco nativo: uma entrada
+                e->value = pc;
+                e->addr = TRACE_GROUP_JIT;
+            }
+            block->exec_count += (ctx.retired + n - 1) / n - 1; // Iterações do laço nativo
+            // Desvios tomados, sem custo no código nativo: o laço só volta
+            // ao início pelo desvio final tomado; a última iteração completa
+            // o tomou se o PC de saída não é o fall-through
+            uint8_t last = block->instrs.back().op;
+            if (last >= OP_BEQ && last <= OP_BGEU) {
+                uint32_t full = ctx.retired / n;
+                if (ctx.retired % n) hpm_events[HPM_EVENT_BRANCH_TAKEN] += full;
+                else if (full) hpm_events[HPM_EVENT_BRANCH_TAKEN] += full - 1 + (pc != block->end_pc);
+            }
+        } else {
+            for (const DecodedInstr& d : block->instrs) {
+                trace_begin(pc, d.raw);
+                pc += d.len;
+                execute(d, bus);
+                trace_result(regs[d.rd]); // Blocos inválidos só são liberados no 'collect'
+                cycle_count++;
+                regs[0] = 0;
+                if (cycle_count >= deadline || blocks.epoch != epoch) break;
+            }
+        }
+        if (blocks.epoch != epoch) block = nullptr; // Pode ter sido invalidado
+    }
 }
 
 // ============================================================
-//  FUNES AUXILIARES DE CSR (CSRs Mnimos)
+//  RUN THREADED – Despacho por "computed goto" (GCC)
+// ============================================================
+// Cada handler salta direto para o próximo através de uma tabela de
+// labels indexada pelo OpId, sem voltar a um switch central. As
+// operações frequentes (ULA, LOAD/STORE, desvios) têm corpo próprio; as
+// raras (CSR, ECALL, FENCE...) usam o 'execute' do motor switch.
+void CPU::run_threaded(Bus& bus)
+{
+#if defined(__GNUC__)
+    if constexpr (TRACE_LEVEL >= TRACE_INSTR) {
+        // Com trace por instrução, o log do 'execute' é a referência
+        run_switch(bus);
+        return;
+    }
+
+    static void* const labels[] = {
+        &&L_GENERIC,                                        // OP_UNDECODED
+        &&L_ADDI, &&L_SLTI, &&L_SLTIU, &&L_XORI, &&L_ORI, &&L_ANDI,
+        &&L_SLLI, &&L_SRLI, &&L_SRAI,
+        &&L_ADD, &&L_SUB, &&L_SLL, &&L_SLT, &&L_SLTU, &&L_XOR,
+        &&L_SRL, &&L_SRA, &&L_OR, &&L_AND,
+        &&L_MUL, &&L_MULH, &&L_MULHSU, &&L_MULHU, &&L_DIV, &&L_DIVU, &&L_REM, &&L_REMU,
+        &&L_LUI, &&L_AUIPC,
+        &&L_LB, &&L_LH, &&L_LW, &&L_LBU, &&L_LHU,
+        &&L_SB, &&L_SH, &&L_SW,
+        &&L_BEQ, &&L_BNE, &&L_BLT, &&L_BGE, &&L_BLTU, &&L_BGEU,
+        &&L_JAL, &&L_JALR,
+        &&L_GENERIC, &&L_GENERIC, &&L_GENERIC, &&L_GENERIC, // FENCE, FENCE.I, ECALL, MRET
+        &&L_GENERIC,                                        // WFI
+        &&L_GENERIC, &&L_GENERIC, &&L_GENERIC,              // CSRRW, CSRRS, CSRRC
+        &&L_GENERIC, &&L_GENERIC, &&L_GENERIC,              // CSRRWI, CSRRSI, CSRRCI
+        &&L_GENERIC, &&L_GENERIC,                           // LR.W, SC.W
+        &&L_GENERIC, &&L_GENERIC, &&L_GENERIC, &&L_GENERIC, // AMOSWAP, AMOADD, AMOXOR, AMOAND
+        &&L_GENERIC, &&L_GENERIC, &&L_GENERIC,              // AMOOR, AMOMIN, AMOMAX
+        &&L_GENERIC, &&L_GENERIC,                           // AMOMINU, AMOMAXU
+        &&L_GENERIC, &&L_GENERIC                            // NOP, ILLEGAL
+    };
+    static_assert(sizeof(labels) / sizeof(labels[0]) == OP_COUNT, "Tabela de labels incompleta");
+
+    // PC, contador de ciclos e a página atual da cache ficam em variáveis
+    // locais (registradores do host); só são sincronizados com os membros
+    // antes de chamar código que os usa (fetch_decoded / execute).
+    const DecodedInstr* d;
+    const DecodedInstr* page = nullptr; // Página da cache do último fetch
+    uint32_t page_pc = 0;               // PC da primeira entrada de 'page'
+    uint32_t lpc = pc;
+    int cycles = cycle_count;
+    const int limit = deadline; // Fim da linha reta (o membro pode ser zerado)
+    uint64_t hits = 0;
+    // Anel de trace: ponteiro que avança uma entrada por instrução (uma
+    // por ciclo, então 'trace.pos' é ajustado pelos ciclos no fim)
+    TraceEntry* const ring = trace.data();
+    TraceEntry* const ring_end = ring + trace.mask + 1;
+    TraceEntry* tr = ring + ((trace.pos - 1) & trace.mask); // Entrada da instrução atual
+    const int start_cycles = cycles;
+
+#define SYNC_OUT() do { pc = lpc; cycle_count = cycles; } while (0)
+#define SYNC_IN()  do { lpc = pc; page = nullptr; } while (0)
+// Busca (pela cache) e salta para o handler da próxima instrução
+#define FETCH_DISPATCH()                                                          \
+    do {                                                                          \
+        uint32_t at = lpc;                                                        \
+        uint32_t off = lpc - page_pc;                                             \
+        if (page && off < DecodeCache::PAGE_BYTES && !(off & 1) &&               \
+            page[off >> 1].op != OP_UNDECODED) {                                  \
+            d = &page[off >> 1];                                                  \
+            hits++;                                                               \
+            if (__builtin_expect(d->len == 4, 1)) lpc += 4; else lpc += 2;       \
+        } else {                                                                  \
+            SYNC_OUT();                                                           \
+            d = &fetch_decoded(bus);                                              \
+            DecodedInstr* e = icache.lookup(lpc);                                 \
+            if (e) { page_pc = lpc & ~(DecodeCache::PAGE_BYTES - 1);              \
+                     page = e - ((lpc - page_pc) >> 1); }                         \
+            else page = nullptr;                                                  \
+            lpc = pc;                                                             \
+        }                                                                         \
+        if (EXEC_TRACE) {                                                         \
+            if (__builtin_expect(++tr == ring_end, 0)) tr = ring;                 \
+            tr->pc = at;                                                          \
+            tr->raw = d->raw;                                                     \
+        }                                                                         \
+        goto *labels[d->op];                                                      \
+    } while (0)
+// Após ULA/desvios/loads: só o fim da linha reta pode encerrar o laço
+#define NEXT()                                                                    \
+    do {                                                                          \
+        if (EXEC_TRACE) tr->value = regs[d->rd];                                  \
+        regs[0] = 0;                                                              \
+        if (++cycles >= limit) goto done;                                         \
+        FETCH_DISPATCH();                                                         \
+    } while (0)
+// Após stores/genéricos: MMIO, CSRs, WFI e erros zeram o 'deadline'. Com
+// a cache compartilhada, a escrita pode ter trocado a página (ver 'share').
+#define NEXT_CHECKED()                                                            \
+    do {                                                                          \
+        if (EXEC_TRACE) tr->value = regs[d->rd];                                  \
+        regs[0] = 0;                                                              \
+        if (++cycles >= deadline) goto done;                                      \
+        if (icache.shared()) page = nullptr;                                      \
+        FETCH_DISPATCH();                                                         \
+    } while (0)
+// Desvio condicional tomado (conta o evento dos mhpmcounters)
+#define TAKE_BRANCH()                                                             \
+    do {                                                                          \
+        lpc = (lpc - 4) + d->imm;                                                 \
+        hpm_events[HPM_EVENT_BRANCH_TAKEN]++;                                     \
+    } while (0)
+
+    if (cycles >= limit) goto done;
+    FETCH_DISPATCH();
+
+    // --- TIPO I ---
+L_ADDI:  regs[d->rd] = regs[d->rs1] + d->imm; NEXT();
+L_SLTI:  regs[d->rd] = ((int32_t)regs[d->rs1] < d->imm); NEXT();
+L_SLTIU: regs[d->rd] = (regs[d->rs1] < (uint32_t)d->imm); NEXT();
+L_XORI:  regs[d->rd] = regs[d->rs1] ^ d->imm; NEXT();
+L_ORI:   regs[d->rd] = regs[d->rs1] | d->imm; NEXT();
+L_ANDI:  regs[d->rd] = regs[d->rs1] & d->imm; NEXT();
+L_SLLI:  regs[d->rd] = regs[d->rs1] << d->imm; NEXT();
+L_SRLI:  regs[d->rd] = regs[d->rs1] >> d->imm; NEXT();
+L_SRAI:  regs[d->rd] = (int32_t)regs[d->rs1] >> d->imm; NEXT();
+
+    // --- TIPO R ---
+L_ADD:  regs[d->rd] = regs[d->rs1] + regs[d->rs2]; NEXT();
+L_SUB:  regs[d->rd] = regs[d->rs1] - regs[d->rs2]; NEXT();
+L_SLL:  regs[d->rd] = regs[d->rs1] << (regs[d->rs2] & 0x1F); NEXT();
+L_SLT:  regs[d->rd] = ((int32_t)regs[d->rs1] < (int32_t)regs[d->rs2]); NEXT();
+L_SLTU: regs[d->rd] = (regs[d->rs1] < regs[d->rs2]); NEXT();
+L_XOR:  regs[d->rd] = regs[d->rs1] ^ regs[d->rs2]; NEXT();
+L_SRL:  regs[d->rd] = regs[d->rs1] >> (regs[d->rs2] & 0x1F); NEXT();
+L_SRA:  regs[d->rd] = (int32_t)regs[d->rs1] >> (regs[d->rs2] & 0x1F); NEXT();
+L_OR:   regs[d->rd] = regs[d->rs1] | regs[d->rs2]; NEXT();
+L_AND:  regs[d->rd] = regs[d->rs1] & regs[d->rs2]; NEXT();
+
+    // --- RV32M ---
+L_MUL:    regs[d->rd] = regs[d->rs1] * regs[d->rs2]; NEXT();
+L_MULH:   regs[d->rd] = rv_mulh(regs[d->rs1], regs[d->rs2]); NEXT();
+L_MULHSU: regs[d->rd] = rv_mulhsu(regs[d->rs1], regs[d->rs2]); NEXT();
+L_MULHU:  regs[d->rd] = rv_mulhu(regs[d->rs1], regs[d->rs2]); NEXT();
+L_DIV:    regs[d->rd] = rv_div(regs[d->rs1], regs[d->rs2]); NEXT();
+L_DIVU:   regs[d->rd] = rv_divu(regs[d->rs1], regs[d->rs2]); NEXT();
+L_REM:    regs[d->rd] = rv_rem(regs[d->rs1], regs[d->rs2]); NEXT();
+L_REMU:   regs[d->rd] = rv_remu(regs[d->rs1], regs[d->rs2]); NEXT();
+
+    // --- TIPO U ---
+L_LUI:   regs[d->rd] = d->imm; NEXT();
+L_AUIPC: regs[d->rd] = (lpc - 4) + d->imm; NEXT();
+
+    // --- LOAD (rd = x0 não acessa o barramento, como no 'execute') ---
+    // O endereço (e o dado dos STOREs) também vai para o anel de trace
+#define MEM_ADDR() (EXEC_TRACE ? (tr->addr = regs[d->rs1] + d->imm) : regs[d->rs1] + d->imm)
+L_LB:
+    if (d->rd) { regs[d->rd] = (int32_t)(int8_t)bus.readByte(MEM_ADDR()); hpm_events[HPM_EVENT_LOAD]++; }
+    NEXT();
+L_LH:
+    if (d->rd) { regs[d->rd] = (int32_t)(int16_t)bus.readHalf(MEM_ADDR()); hpm_events[HPM_EVENT_LOAD]++; }
+    NEXT();
+L_LW:
+    if (d->rd) { regs[d->rd] = bus.readWord(MEM_ADDR()); hpm_events[HPM_EVENT_LOAD]++; }
+    NEXT();
+L_LBU:
+    if (d->rd) { regs[d->rd] = bus.readByte(MEM_ADDR()); hpm_events[HPM_EVENT_LOAD]++; }
+    NEXT();
+L_LHU:
+    if (d->rd) { regs[d->rd] = bus.readHalf(MEM_ADDR()); hpm_events[HPM_EVENT_LOAD]++; }
+    NEXT();
+
+    // --- STORE ---
+L_SB:
+    if (EXEC_TRACE) tr->data = regs[d->rs2];
+    bus.writeByte(MEM_ADDR(), regs[d->rs2] & 0xFF);
+    hpm_events[HPM_EVENT_STORE]++;
+    NEXT_CHECKED();
+L_SH:
+    if (EXEC_TRACE) tr->data = regs[d->rs2];
+    bus.writeHalf(MEM_ADDR(), regs[d->rs2] & 0xFFFF);
+    hpm_events[HPM_EVENT_STORE]++;
+    NEXT_CHECKED();
+L_SW:
+    if (EXEC_TRACE) tr->data = regs[d->rs2];
+    bus.writeWord(MEM_ADDR(), regs[d->rs2]);
+    hpm_events[HPM_EVENT_STORE]++;
+    NEXT_CHECKED();
+
+    // --- TIPO B ---
+L_BEQ:  if (regs[d->rs1] == regs[d->rs2]) TAKE_BRANCH(); NEXT();
+L_BNE:  if (regs[d->rs1] != regs[d->rs2]) TAKE_BRANCH(); NEXT();
+L_BLT:  if ((int32_t)regs[d->rs1] < (int32_t)regs[d->rs2]) TAKE_BRANCH(); NEXT();
+L_BGE:  if ((int32_t)regs[d->rs1] >= (int32_t)regs[d->rs2]) TAKE_BRANCH(); NEXT();
+L_BLTU: if (regs[d->rs1] < regs[d->rs2]) TAKE_BRANCH(); NEXT();
+L_BGEU: if (regs[d->rs1] >= regs[d->rs2]) TAKE_BRANCH(); NEXT();
+
+    // --- JAL / JALR ---
+L_JAL:
+    regs[d->rd] = lpc;
+    lpc = (lpc - 4) + d->imm;
+    NEXT();
+L_JALR:
+    {
+        uint32_t target = (regs[d->rs1] + d->imm) & ~1;
+        regs[d->rd] = lpc;
+        lpc = target;
+    }
+    NEXT();
+
+    // --- Demais (SISTEMA, FENCE, atômicas, erros): motor switch ---
+L_GENERIC:
+    SYNC_OUT();
+    if (EXEC_TRACE) trace_entry = tr;
+    execute(*d, bus); // Pode alterar o PC ou descartar a cache (FENCE.I)
+    SYNC_IN();
+    NEXT_CHECKED();
+
+done:
+    SYNC_OUT();
+    icache.hits += hits;
+    if (EXEC_TRACE) trace.pos += (uint32_t)(cycles - start_cycles);
+    return;
+
+#undef MEM_ADDR
+#undef TAKE_BRANCH
+#undef NEXT_CHECKED
+#undef NEXT
+#undef FETCH_DISPATCH
+#undef SYNC_IN
+#undef SYNC_OUT
+#else
+    // Sem 'computed goto' (compilador não-GCC): usa o motor switch
+    run_switch(bus);
+#endif
+}
+
+// ============================================================
+//  FUNÇÕES AUXILIARES DE CSR (CSRs Mínimos)
 // ============================================================
 uint32_t CPU::read_csr(uint32_t addr)
 {
@@ -74,29 +800,89 @@ uint32_t CPU::read_csr(uint32_t addr)
     case 0x305: return mtvec;
     case 0x341: return mepc;
     case 0x342: return mcause;
+    case 0x344: return pending_interrupts(); // mip: reflexo do CLINT (somente leitura)
     case 0x180: return satp;
     case 0x3a0: return pmpcfg0;
     case 0x3b0: return pmpaddr0;
     case 0xF14: return mhartid;
-    default: return 0;
+
+    // Contadores (64 bits, em duas metades; os 0xC.. são as cópias
+    // somente-leitura do modo usuário)
+    case 0xB00: case 0xC00: return (uint32_t)(cycles() + mcycle_offset);
+    case 0xB80: case 0xC80: return (uint32_t)((cycles() + mcycle_offset) >> 32);
+    case 0xB02: case 0xC02: return (uint32_t)(instret() + minstret_offset);
+    case 0xB82: case 0xC82: return (uint32_t)((instret() + minstret_offset) >> 32);
+    case 0xC01: return (uint32_t)time_now();
+    case 0xC81: return (uint32_t)(time_now() >> 32);
+    default: break;
+    }
+
+    // mhpmcounter3..31 / hpmcounter3..31 (e metades altas), mhpmevent3..31
+    uint32_t n = addr & 0x1F;
+    if (n >= 3) {
+        switch (addr & ~0x1Fu)
+        {
+        case 0xB00: case 0xC00: return (uint32_t)hpm_counter(n - 3);
+        case 0xB80: case 0xC80: return (uint32_t)(hpm_counter(n - 3) >> 32);
+        case 0x320: return mhpmevent[n - 3];
+        }
     }
+    return 0;
+}
+
+// Grava a metade 'high' (ou a baixa) de um contador de 64 bits cujo
+// valor atual é 'current'; devolve o novo valor
+static uint64_t with_half(uint64_t current, uint32_t value, bool high)
+{
+    if (high) return (current & 0xFFFFFFFFull) | ((uint64_t)value << 32);
+    return (current & ~0xFFFFFFFFull) | value;
 }
 
 void CPU::write_csr(uint32_t addr, uint32_t value)
 {
     switch(addr)
     {
-    case 0x300: mstatus = value; break;
+    // mstatus/mie mudam o que o agendador calculou: novo ponto de serviço
+    case 0x300: mstatus = value; deadline = 0; break;
     case 0x302: medeleg = value; break;
     case 0x303: mideleg = value; break;
-    case 0x304: mie = value; break;
+    case 0x304: mie = value & (MIP_MSIP | MIP_MTIP); deadline = 0; break;
     case 0x305: mtvec = value; break;
     case 0x341: mepc = value; break;
     case 0x342: mcause = value; break;
     case 0x180: satp = value; break;
     case 0x3a0: pmpcfg0 = value; break;
     case 0x3b0: pmpaddr0 = value; break;
-    default: break;
+
+    // A instrução que grava mcycle/minstret ainda vai ser contada: o
+    // valor gravado é o que a próxima instrução lê
+    case 0xB00: case 0xB80:
+        mcycle_offset = with_half(cycles() + mcycle_offset, value, addr == 0xB80) - (cycles() + 1);
+        break;
+    case 0xB02: case 0xB82:
+        minstret_offset = with_half(instret() + minstret_offset, value, addr == 0xB82) - (instret() + 1);
+        break;
+
+    default:
+    {
+        uint32_t n = addr & 0x1F;
+        if (n < 3) break;
+        int i = n - 3;
+        switch (addr & ~0x1Fu)
+        {
+        case 0xB00: case 0xB80:
+            hpm_offset[i] = with_half(hpm_counter(i), value, addr >= 0xB80) - hpm_events[mhpmevent[i]];
+            break;
+        case 0x320: // Troca o evento mantendo o valor atual do contador
+        {
+            uint64_t current = hpm_counter(i);
+            mhpmevent[i] = value < HPM_EVENT_COUNT ? value : (uint32_t)HPM_EVENT_NONE;
+            hpm_offset[i] = current - hpm_events[mhpmevent[i]];
+            break;
+        }
+        }
+        break;
+    }
     }
 }
 
@@ -107,340 +893,404 @@ void CPU::write_csr(uint32_t addr, uint32_t value)
 uint32_t CPU::fetch(Bus& bus)
 {
     // DEBUG: Informa o PC antes da leitura
-    std::cout << "[FETCH] PC: 0x" << std::hex << pc << " (Lendo instruo)\n";
+    TRACE(TRACE_INSTR, "[FETCH] PC: 0x" << std::hex << pc << " (Lendo instrução)\n");
 
-    uint32_t instr = bus.readWord(pc);
+    // RV32C: a instrução pode ter 16 bits (bits [1:0] != 11) e as de 32
+    // bits só precisam de alinhamento de 2 bytes
+    uint32_t instr = bus.readHalf(pc);
+    if ((instr & 3) == 3) {
+        instr |= (uint32_t)bus.readHalf(pc + 2) << 16;
+        pc += 4;
+    } else {
+        pc += 2;
+    }
 
-    // DEBUG: Informa a instruo lida
-    std::cout << "[FETCH] Instruo lida: 0x" << std::hex << instr << "\n";
+    // DEBUG: Informa a instrução lida
+    TRACE(TRACE_INSTR, "[FETCH] Instrução lida: 0x" << std::hex << instr << "\n");
 
-    pc += 4;
     return instr;
 }
 
 // ============================================================
-//  EXECUTE  Decodifica e executa (com Logs de Debug)
+//  FETCH DECODIFICADO – Consulta a cache antes do barramento
+// ============================================================
+const DecodedInstr& CPU::fetch_decoded(Bus& bus)
+{
+    DecodedInstr* entry = icache.lookup(pc);
+
+    if (entry && entry->op != OP_UNDECODED) {
+        icache.hits++;
+        TRACE(TRACE_INSTR, "[FETCH] PC: 0x" << std::hex << pc << " (Cache) | Instrução: 0x" << entry->raw << "\n");
+        // Desvio em vez de 'pc += len': o PC seguinte não espera a leitura
+        // da entrada (as de 32 bits são a regra)
+        if (__builtin_expect(entry->len == 4, 1)) pc += 4; else pc += 2;
+        return *entry;
+    }
+
+    // Falha (ou PC fora da RAM): busca pelo barramento e decodifica
+    icache.misses++;
+    uint32_t instr = fetch(bus);
+    if (!entry) entry = &uncached;
+    *entry = decode_instr(instr);
+    return *entry;
+}
+
+// ============================================================
+//  ATÔMICAS FORA DA RAM OU DESALINHADAS
+// ============================================================
+// A especificação pede uma exceção (endereço desalinhado ou falha de
+// acesso); sem traps síncronas, o hart para como num opcode inválido, em
+// vez de fazer uma leitura + escrita sem atomicidade entre harts
+bool CPU::check_atomic_address(Bus& bus, const DecodedInstr& d, uint32_t addr)
+{
+    if (bus.isAtomicAccess(addr)) return true;
+    log_err() << ">>> ERRO FATAL: " << op_name(d.op) << ((addr & 3) ? " desalinhada" : " fora da RAM")
+              << " (endereço 0x" << std::hex << addr << ", em PC=0x" << (pc - d.len) << ")" << std::dec << "\n";
+    running = false;
+    deadline = 0;
+    return false;
+}
+
+// ============================================================
+//  EXECUTE – Decodifica e executa
 // ============================================================
 void CPU::execute(uint32_t instr, Bus& bus)
 {
-    uint32_t opcode = instr & 0x7F;
-    uint32_t rd     = (instr >> 7)  & 0x1F;
-    uint32_t funct3 = (instr >> 12) & 0x7;
-    uint32_t rs1    = (instr >> 15) & 0x1F;
-    uint32_t rs2    = (instr >> 20) & 0x1F;
-    uint32_t funct7 = (instr >> 25) & 0x7F;
+    execute(decode_instr(instr), bus);
+}
+
+// ============================================================
+//  EXECUTE – Executa a forma decodificada (com Logs de Debug)
+// ============================================================
+void CPU::execute(const DecodedInstr& d, Bus& bus)
+{
+    const uint32_t rd = d.rd, rs1 = d.rs1, rs2 = d.rs2;
+    const int32_t imm = d.imm;
 
-    // DEBUG GERAL DE INSTRUO (Em vez do log detalhado aqui, usamos o log do FETCH)
-    // std::cout << "[CYCLE " << std::dec << cycle_count << "] PC: 0x" << std::hex << (pc - 4)
-    //           << " | INSTR: 0x" << instr << " | Op: 0x" << opcode << std::dec;
+    TRACE(TRACE_INSTR, " [EXEC] " << op_name(d.op) << std::dec << " | rd:" << rd << ", rs1:" << rs1
+                       << ", rs2:" << rs2 << ", imm:" << imm << "\n");
 
-    switch (opcode)
+    switch (d.op)
     {
 
     // ========================================================
-    //  TIPO I  Operaes imediatas (ADDI, SLLI, SRLI, etc.)
+    //  TIPO I – Operações imediatas (ADDI, SLLI, SRLI, etc.)
     // ========================================================
-    case 0x13:
-    {
-        int32_t imm = (int32_t)(instr & 0xFFF00000) >> 20;
-        std::cout << " [EXEC] ADDI/SLLI/SRLI... | rd:" << rd << ", rs1:" << rs1 << ", imm:" << imm << "\n";
-        switch (funct3)
-        {
-        case 0x0: regs[rd] = regs[rs1] + imm; break; // ADDI
-        case 0x2: regs[rd] = ((int32_t)regs[rs1] < imm); break; // SLTI
-        case 0x3: regs[rd] = (regs[rs1] < (uint32_t)imm); break; // SLTIU
-        case 0x4: regs[rd] = regs[rs1] ^ imm; break; // XORI
-        case 0x6: regs[rd] = regs[rs1] | imm; break; // ORI
-        case 0x7: regs[rd] = regs[rs1] & imm; break; // ANDI
-        case 0x1: regs[rd] = regs[rs1] << (imm & 0x1F); break; // SLLI
-        case 0x5: // SRLI / SRAI
-            if (funct7 == 0x00) regs[rd] = regs[rs1] >> (imm & 0x1F); // SRLI
-            else if (funct7 == 0x20) regs[rd] = (int32_t)regs[rs1] >> (imm & 0x1F); // SRAI
-            break;
-        default:
-            std::cerr << "ERRO: Funct3 desconhecido para Opcode 0x13\n";
-            running = false;
-            break;
-        }
-        break;
-    }
+    case OP_ADDI:  regs[rd] = regs[rs1] + imm; break;
+    case OP_SLTI:  regs[rd] = ((int32_t)regs[rs1] < imm); break;
+    case OP_SLTIU: regs[rd] = (regs[rs1] < (uint32_t)imm); break;
+    case OP_XORI:  regs[rd] = regs[rs1] ^ imm; break;
+    case OP_ORI:   regs[rd] = regs[rs1] | imm; break;
+    case OP_ANDI:  regs[rd] = regs[rs1] & imm; break;
+    case OP_SLLI:  regs[rd] = regs[rs1] << imm; break; // imm já é o shamt
+    case OP_SRLI:  regs[rd] = regs[rs1] >> imm; break;
+    case OP_SRAI:  regs[rd] = (int32_t)regs[rs1] >> imm; break;
+
     // ========================================================
-    //  TIPO R  Operaes entre registradores (ADD, SUB, AND)
+    //  TIPO R – Operações entre registradores (ADD, SUB, AND…)
     // ========================================================
-    case 0x33:
-    {
-        std::cout << " [EXEC] ADD/SUB/SLL... | rd:" << rd << ", rs1:" << rs1 << ", rs2:" << rs2 << ", F7:" << funct7 << "\n";
-        switch (funct3)
-        {
-        case 0x0: // ADD / SUB
-            if (funct7 == 0x20) regs[rd] = regs[rs1] - regs[rs2]; // SUB
-            else regs[rd] = regs[rs1] + regs[rs2]; // ADD
-            break;
-        case 0x1: regs[rd] = regs[rs1] << (regs[rs2] & 0x1F); break; // SLL
-        case 0x2: regs[rd] = ((int32_t)regs[rs1] < (int32_t)regs[rs2]); break; // SLT
-        case 0x3: regs[rd] = (regs[rs1] < regs[rs2]); break; // SLTU
-        case 0x4: regs[rd] = regs[rs1] ^ regs[rs2]; break; // XOR
-        case 0x5: // SRL / SRA
-            if (funct7 == 0x00) regs[rd] = regs[rs1] >> (regs[rs2] & 0x1F); // SRL
-            else if (funct7 == 0x20) regs[rd] = (int32_t)regs[rs1] >> (regs[rs2] & 0x1F); // SRA
-            break;
-        case 0x6: regs[rd] = regs[rs1] | regs[rs2]; break; // OR
-        case 0x7: regs[rd] = regs[rs1] & regs[rs2]; break; // AND
-        default:
-            std::cerr << "ERRO: Funct3 desconhecido para Opcode 0x33\n";
-            running = false;
-            break;
-        }
-        break;
-    }
+    case OP_ADD:  regs[rd] = regs[rs1] + regs[rs2]; break;
+    case OP_SUB:  regs[rd] = regs[rs1] - regs[rs2]; break;
+    case OP_SLL:  regs[rd] = regs[rs1] << (regs[rs2] & 0x1F); break;
+    case OP_SLT:  regs[rd] = ((int32_t)regs[rs1] < (int32_t)regs[rs2]); break;
+    case OP_SLTU: regs[rd] = (regs[rs1] < regs[rs2]); break;
+    case OP_XOR:  regs[rd] = regs[rs1] ^ regs[rs2]; break;
+    case OP_SRL:  regs[rd] = regs[rs1] >> (regs[rs2] & 0x1F); break;
+    case OP_SRA:  regs[rd] = (int32_t)regs[rs1] >> (regs[rs2] & 0x1F); break;
+    case OP_OR:   regs[rd] = regs[rs1] | regs[rs2]; break;
+    case OP_AND:  regs[rd] = regs[rs1] & regs[rs2]; break;
+
+    // ========================================================
+    //  RV32M – Multiplicação / divisão (funct7 = 0x01)
     // ========================================================
-    //  TIPO U  LUI / AUIPC
+    case OP_MUL:    regs[rd] = regs[rs1] * regs[rs2]; break;
+    case OP_MULH:   regs[rd] = rv_mulh(regs[rs1], regs[rs2]); break;
+    case OP_MULHSU: regs[rd] = rv_mulhsu(regs[rs1], regs[rs2]); break;
+    case OP_MULHU:  regs[rd] = rv_mulhu(regs[rs1], regs[rs2]); break;
+    case OP_DIV:    regs[rd] = rv_div(regs[rs1], regs[rs2]); break;
+    case OP_DIVU:   regs[rd] = rv_divu(regs[rs1], regs[rs2]); break;
+    case OP_REM:    regs[rd] = rv_rem(regs[rs1], regs[rs2]); break;
+    case OP_REMU:   regs[rd] = rv_remu(regs[rs1], regs[rs2]); break;
+
     // ========================================================
-    case 0x37:
-        std::cout << " [EXEC] LUI | rd:" << rd << "\n";
-        regs[rd] = (instr & 0xFFFFF000);
-        break; // LUI
-    case 0x17:
-        std::cout << " [EXEC] AUIPC | rd:" << rd << "\n";
-        regs[rd] = (pc - 4) + (instr & 0xFFFFF000);
-        break; // AUIPC
-
-// ========================================================
-//  TIPO I (LOAD) - Opcode 0x03
-// ========================================================
-    case 0x03:
+    //  TIPO U – LUI / AUIPC
+    // ========================================================
+    case OP_LUI:   regs[rd] = imm; break;
+    case OP_AUIPC: regs[rd] = (pc - 4) + imm; break;
+
+    // ========================================================
+    //  TIPO I (LOAD) - Opcode 0x03
+    // ========================================================
+    case OP_LB:
+    case OP_LH:
+    case OP_LW:
+    case OP_LBU:
+    case OP_LHU:
     {
-        int32_t imm = (int32_t)instr >> 20;
         uint32_t addr = regs[rs1] + imm;
-
-        // DEBUG DE LOAD
-        std::cout << " [EXEC] LOAD (LB/LH/LW/LBU/LHU) | F3: 0x" << funct3 << " | Dest Addr: 0x" << std::hex << addr << "\n";
+        trace_access(addr);
+        TRACE(TRACE_MEM, "    -> LOAD | Dest Addr: 0x" << std::hex << addr << "\n");
 
         if (rd == 0) break;
+        hpm_events[HPM_EVENT_LOAD]++;
 
-        switch (funct3)
+        switch (d.op)
         {
-        // LB (Load Byte) - Extenso de Sinal
-        case 0x0:
+        // LB (Load Byte) - Extensão de Sinal
+        case OP_LB:
             regs[rd] = (int32_t)(int8_t)bus.readByte(addr);
-            std::cout << "    -> LB (Sinal) | Valor lido: 0x" << std::hex << regs[rd] << "\n";
             break;
 
-        // LH (Load Half-word) - Extenso de Sinal
-        case 0x1:
-        {
-            uint16_t half_word_signed = (uint16_t)bus.readByte(addr) |
-                                        ((uint16_t)bus.readByte(addr + 1) << 8);
-            regs[rd] = (int32_t)(int16_t)half_word_signed;
-            std::cout << "    -> LH (Sinal) | Valor lido: 0x" << std::hex << regs[rd] << "\n";
+        // LH (Load Half-word) - Extensão de Sinal
+        case OP_LH:
+            regs[rd] = (int32_t)(int16_t)bus.readHalf(addr);
             break;
-        }
 
         // LW (Load Word)
-        case 0x2:
+        case OP_LW:
             regs[rd] = bus.readWord(addr);
-            std::cout << "    -> LW | Valor lido: 0x" << std::hex << regs[rd] << "\n";
             break;
 
-        // LBU (Load Byte Unsigned) - Extenso Zero
-        case 0x4:
+        // LBU (Load Byte Unsigned) - Extensão Zero
+        case OP_LBU:
             regs[rd] = (uint32_t)bus.readByte(addr);
-            std::cout << "    -> LBU (Zero) | Valor lido: 0x" << std::hex << regs[rd] << "\n";
             break;
 
-        // LHU (Load Half-word Unsigned) - Extenso Zero
-        case 0x5:
-        {
-            uint16_t half_word_unsigned = (uint16_t)bus.readByte(addr) |
-                                          ((uint16_t)bus.readByte(addr + 1) << 8);
-            regs[rd] = (uint32_t)half_word_unsigned;
-            std::cout << "    -> LHU (Zero) | Valor lido: 0x" << std::hex << regs[rd] << "\n";
-            break;
-        }
-
-        default:
-            std::cerr << "ERRO: Funct3 desconhecido para Opcode 0x03\n";
-            running = false;
+        // LHU (Load Half-word Unsigned) - Extensão Zero
+        case OP_LHU:
+            regs[rd] = (uint32_t)bus.readHalf(addr);
             break;
         }
+        TRACE(TRACE_MEM, "    -> " << op_name(d.op) << " | Valor lido: 0x" << std::hex << regs[rd] << "\n");
         break;
     }
 
-
-// ========================================================
-//  TIPO S (STORE) - Opcode 0x23
-// ========================================================
-    case 0x23:
+    // ========================================================
+    //  TIPO S (STORE) - Opcode 0x23
+    // ========================================================
+    case OP_SB:
     {
-        // Clculo do Imediato S-Type
-        uint32_t imm_11_5 = (instr >> 25) & 0x7F;
-        uint32_t imm_4_0  = (instr >> 7)  & 0x1F;
-        int32_t imm = (imm_11_5 << 5) | imm_4_0;
-        if (imm & 0x800) imm |= 0xFFFFF000;
-
         uint32_t addr = regs[rs1] + imm;
+        trace_access(addr, regs[rs2]);
+        bus.writeByte(addr, regs[rs2] & 0xFF);
+        hpm_events[HPM_EVENT_STORE]++;
+        TRACE(TRACE_MEM, "    -> SB | Addr: 0x" << std::hex << addr << " | Escrito byte: 0x" << (regs[rs2] & 0xFF) << "\n");
+        break;
+    }
 
-        // DEBUG DE STORE
-        std::cout << " [EXEC] STORE (SB/SH/SW) | F3: 0x" << funct3 << " | Dest Addr: 0x" << std::hex << addr
-                  << " | Valor RS2: 0x" << regs[rs2] << std::dec << "\n";
-
-        switch (funct3)
-        {
-
-        // SB (Store Byte)
-        case 0x0:
-            bus.writeByte(addr, regs[rs2] & 0xFF);
-            std::cout << "    -> SB | Escrito byte: 0x" << std::hex << (regs[rs2] & 0xFF) << "\n";
-            break;
-
-        // SH (Store Half-word) - Little-Endian
-        case 0x1:
-            bus.writeByte(addr, (regs[rs2] >> 0) & 0xFF);
-            bus.writeByte(addr+1, (regs[rs2] >> 8) & 0xFF);
-            std::cout << "    -> SH | Escrito half-word: 0x" << std::hex << (regs[rs2] & 0xFFFF) << "\n";
-            break;
-
-        // SW (Store Word)
-        case 0x2:
-            bus.writeWord(addr, regs[rs2]);
-            std::cout << "    -> SW | Escrito word: 0x" << std::hex << regs[rs2] << "\n";
-            break;
-
-        default:
-            std::cerr << "ERRO: Funct3 desconhecido para Opcode 0x23\n";
-            running = false;
-            break;
-        }
+    // SH (Store Half-word) - Little-Endian
+    case OP_SH:
+    {
+        uint32_t addr = regs[rs1] + imm;
+        trace_access(addr, regs[rs2]);
+        bus.writeHalf(addr, regs[rs2] & 0xFFFF);
+        hpm_events[HPM_EVENT_STORE]++;
+        TRACE(TRACE_MEM, "    -> SH | Addr: 0x" << std::hex << addr << " | Escrito half-word: 0x" << (regs[rs2] & 0xFFFF) << "\n");
         break;
     }
 
+    case OP_SW:
+    {
+        uint32_t addr = regs[rs1] + imm;
+        trace_access(addr, regs[rs2]);
+        bus.writeWord(addr, regs[rs2]);
+        hpm_events[HPM_EVENT_STORE]++;
+        TRACE(TRACE_MEM, "    -> SW | Addr: 0x" << std::hex << addr << " | Escrito word: 0x" << regs[rs2] << "\n");
+        break;
+    }
 
     // ========================================================
-    //  TIPO B  Desvios condicionais
+    //  TIPO B – Desvios condicionais
     // ========================================================
-    case 0x63:
+    case OP_BEQ:
+    case OP_BNE:
+    case OP_BLT:
+    case OP_BGE:
+    case OP_BLTU:
+    case OP_BGEU:
     {
-        // Clculo do imediato B-Type
-        int32_t imm = (((int32_t)instr >> 31) << 12) |
-                      (((instr >> 7) & 0x1) << 11) |
-                      (((instr >> 25) & 0x3F) << 5) |
-                      (((instr >> 8) & 0xF) << 1);
-        if (imm & 0x1000) imm |= 0xFFFFE000;
         bool take = false;
-
-        std::cout << " [EXEC] BRANCH (BEQ/BNE/...) | F3: 0x" << funct3 << " | RS1: 0x" << regs[rs1]
-                  << " | RS2: 0x" << regs[rs2] << "\n";
-
-        switch (funct3)
+        switch (d.op)
         {
-        case 0x0: take = (regs[rs1] == regs[rs2]); break; // BEQ
-        case 0x1: take = (regs[rs1] != regs[rs2]); break; // BNE
-        case 0x4: take = ((int32_t)regs[rs1] < (int32_t)regs[rs2]); break; // BLT
-        case 0x5: take = ((int32_t)regs[rs1] >= (int32_t)regs[rs2]); break; // BGE
-        case 0x6: take = (regs[rs1] < regs[rs2]); break; // BLTU
-        case 0x7: take = (regs[rs1] >= regs[rs2]); break; // BGEU
-        default:
-            std::cerr << "ERRO: Funct3 desconhecido para Opcode 0x63\n";
-            running = false;
-            break;
+        case OP_BEQ:  take = (regs[rs1] == regs[rs2]); break;
+        case OP_BNE:  take = (regs[rs1] != regs[rs2]); break;
+        case OP_BLT:  take = ((int32_t)regs[rs1] < (int32_t)regs[rs2]); break;
+        case OP_BGE:  take = ((int32_t)regs[rs1] >= (int32_t)regs[rs2]); break;
+        case OP_BLTU: take = (regs[rs1] < regs[rs2]); break;
+        case OP_BGEU: take = (regs[rs1] >= regs[rs2]); break;
         }
         if (take) {
             pc = (pc - 4) + imm;
-            std::cout << "    -> BRANCH TAKE | PC target: 0x" << std::hex << pc << "\n";
+            hpm_events[HPM_EVENT_BRANCH_TAKEN]++;
+            TRACE(TRACE_INSTR, "    -> BRANCH TAKE | PC target: 0x" << std::hex << pc << "\n");
         }
         break;
     }
+
     // ========================================================
     //  JAL / JALR
     // ========================================================
-    case 0x6F: // JAL
-    {
-        // Clculo do imediato J-Type
-        int32_t imm = (((int32_t)instr >> 31) << 20) |
-                      (((instr >> 12) & 0xFF) << 12) |
-                      (((instr >> 20) & 0x1) << 11) |
-                      (((instr >> 21) & 0x3FF) << 1);
-        if (imm & 0x100000) imm |= 0xFFE00000;
-
-        std::cout << " [EXEC] JAL | rd:" << rd << " | PC target: 0x" << std::hex << ((pc - 4) + imm) << "\n";
-
+    case OP_JAL:
         regs[rd] = pc;
         pc = (pc - 4) + imm;
+        TRACE(TRACE_INSTR, "    -> JAL | PC target: 0x" << std::hex << pc << "\n");
         break;
-    }
-    case 0x67: // JALR
+
+    case OP_JALR:
     {
-        int32_t imm = (int32_t)instr >> 20;
         uint32_t target = (regs[rs1] + imm) & ~1;
-
-        std::cout << " [EXEC] JALR | rd:" << rd << " | PC target: 0x" << std::hex << target << "\n";
-
         regs[rd] = pc;
         pc = target;
+        TRACE(TRACE_INSTR, "    -> JALR | PC target: 0x" << std::hex << pc << "\n");
         break;
     }
+
     // ========================================================
-    //  FENCE
+    //  FENCE / FENCE.I
     // ========================================================
-    case 0x0F:
-        std::cout << " [EXEC] FENCE | NOP\n";
+    case OP_FENCE:
+        // Com vários harts (SMP), as escritas de um ficam visíveis aos
+        // outros na ordem definida pela barreira do host
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        break;
+
+    case OP_NOP:
+        break;
+
+    case OP_FENCE_I:
+        // As instruções já decodificadas/traduzidas podem estar desatualizadas
+        icache.flush();
+        blocks.flush();
         break;
 
     // ========================================================
-    //  SISTEMA (ECALL / EBREAK / CSR)
+    //  ATÔMICAS (RV32A) - Opcode 0x2F
     // ========================================================
-    case 0x73:
+    case OP_LR_W:
     {
-        uint32_t csr_addr = (instr >> 20) & 0xFFF;
-        std::cout << " [EXEC] SYSTEM (ECALL/CSR) | F3: 0x" << funct3 << " | CSR: 0x" << csr_addr << "\n";
+        uint32_t addr = regs[rs1];
+        trace_access(addr);
+        if (!check_atomic_address(bus, d, addr)) break;
+        uint32_t value = bus.loadAtomic(addr);
+        reservation_addr = addr;
+        reservation_value = value;
+        reservation_valid = true;
+        regs[rd] = value;
+        atomics++;
+        TRACE(TRACE_MEM, "    -> LR.W | Addr: 0x" << std::hex << addr << " | Valor lido: 0x" << value << "\n");
+        break;
+    }
 
-        if (funct3 == 0)
-        {
-            // ECALL / EBREAK / MRET
-            if (instr == 0x00000073)   // ECALL
-            {
-                std::cout << "    -> ECALL | Trap para 0x" << std::hex << mtvec << "\n";
-                mcause = 11;
-                mepc = pc - 4;
-                pc = mtvec;
-            }
-            else if (instr == 0x30200073)     // MRET
-            {
-                std::cout << "    -> MRET | Retornando para 0x" << std::hex << mepc << "\n";
-                pc = mepc;
-            }
-            else
-            {
-                std::cerr << "    -> EBREAK ou instruo SYSTEM desconhecida: 0x" << std::hex << instr << "\n";
-                running = false;
-            }
-        }
-        else // Instrues CSR
+    case OP_SC_W:
+    {
+        // Sucesso (rd = 0) só se a palavra ainda tiver o valor do LR.W;
+        // a reserva é consumida de qualquer forma
+        uint32_t addr = regs[rs1];
+        trace_access(addr, regs[rs2]);
+        if (!check_atomic_address(bus, d, addr)) break;
+        bool stored = reservation_valid && reservation_addr == addr &&
+                      bus.casWord(addr, reservation_value, regs[rs2]);
+        reservation_valid = false;
+        regs[rd] = stored ? 0 : 1;
+        atomics++;
+        TRACE(TRACE_MEM, "    -> SC.W | Addr: 0x" << std::hex << addr << (stored ? " | OK" : " | Falhou") << "\n");
+        break;
+    }
+
+    case OP_AMOSWAP_W:
+    case OP_AMOADD_W:
+    case OP_AMOXOR_W:
+    case OP_AMOAND_W:
+    case OP_AMOOR_W:
+    case OP_AMOMIN_W:
+    case OP_AMOMAX_W:
+    case OP_AMOMINU_W:
+    case OP_AMOMAXU_W:
+    {
+        uint32_t addr = regs[rs1];
+        trace_access(addr, regs[rs2]);
+        if (!check_atomic_address(bus, d, addr)) break;
+        uint32_t old = bus.amoWord(addr, d.op, regs[rs2]);
+        regs[rd] = old;
+        atomics++;
+        TRACE(TRACE_MEM, "    -> " << op_name(d.op) << " | Addr: 0x" << std::hex << addr
+                         << " | Valor antigo: 0x" << old << "\n");
+        break;
+    }
+
+    // ========================================================
+    //  SISTEMA (ECALL / MRET / CSR)
+    // ========================================================
+    case OP_ECALL:
+        TRACE(TRACE_INSTR, "    -> ECALL | Trap para 0x" << std::hex << mtvec << "\n");
+        mcause = 11;
+        mepc = pc - d.len;
+        mstatus = (mstatus & ~(MSTATUS_MIE | MSTATUS_MPIE)) | ((mstatus & MSTATUS_MIE) ? MSTATUS_MPIE : 0);
+        hpm_events[HPM_EVENT_TRAP]++;
+        pc = mtvec & ~3u; // Exceções sempre vão para BASE
+        break;
+
+    case OP_MRET:
+        TRACE(TRACE_INSTR, "    -> MRET | Retornando para 0x" << std::hex << mepc << "\n");
+        pc = mepc;
+        mstatus = (mstatus & ~MSTATUS_MIE) | ((mstatus & MSTATUS_MPIE) ? MSTATUS_MIE : 0) | MSTATUS_MPIE;
+        deadline = 0; // Pode reabilitar uma interrupção pendente
+        break;
+
+    case OP_WFI:
+        // Sem interrupção pendente (e habilitada em mie), para até o
+        // próximo evento; o agendador avança o tempo direto até ele
+        TRACE(TRACE_INSTR, "    -> WFI\n");
+        if (!(pending_interrupts() & mie)) waiting = true;
+        deadline = 0;
+        break;
+
+    case OP_CSRRW:
+    case OP_CSRRS:
+    case OP_CSRRC:
+    case OP_CSRRWI:
+    case OP_CSRRSI:
+    case OP_CSRRCI:
+    {
+        uint32_t csr_addr = (uint32_t)imm;
+        hpm_events[HPM_EVENT_CSR]++;
+        uint32_t old_val = read_csr(csr_addr);
+        uint32_t src = regs[rs1]; // Lido antes de gravar rd (rd pode ser rs1, ou x0)
+        // CSRRS/CSRRC com rs1 = x0 (ou uimm = 0) só leem: "csrr" de um
+        // contador não pode regravá-lo
+        switch (d.op)
         {
-            uint32_t imm = (instr >> 15) & 0x1F;
-            uint32_t old_val = read_csr(csr_addr);
-            switch (funct3)
-            {
-            case 0x1: regs[rd] = old_val; write_csr(csr_addr, regs[rs1]); break;
-            case 0x2: regs[rd] = old_val; write_csr(csr_addr, old_val | regs[rs1]); break;
-            case 0x3: regs[rd] = old_val; write_csr(csr_addr, old_val & ~regs[rs1]); break;
-            case 0x5: regs[rd] = old_val; write_csr(csr_addr, imm); break;
-            case 0x6: regs[rd] = old_val; write_csr(csr_addr, old_val | imm); break;
-            case 0x7: regs[rd] = old_val; write_csr(csr_addr, old_val & ~imm); break;
-            }
+        case OP_CSRRW:  regs[rd] = old_val; write_csr(csr_addr, src); break;
+        case OP_CSRRS:  regs[rd] = old_val; if (rs1) write_csr(csr_addr, old_val | src); break;
+        case OP_CSRRC:  regs[rd] = old_val; if (rs1) write_csr(csr_addr, old_val & ~src); break;
+        case OP_CSRRWI: regs[rd] = old_val; write_csr(csr_addr, rs1); break;
+        case OP_CSRRSI: regs[rd] = old_val; if (rs1) write_csr(csr_addr, old_val | rs1); break;
+        case OP_CSRRCI: regs[rd] = old_val; if (rs1) write_csr(csr_addr, old_val & ~rs1); break;
         }
         break;
     }
 
     // --------------------------------------------------------
-    //  OPCODE DESCONHECIDO (Captura de Erro)
+    //  OPCODE / FUNCT3 DESCONHECIDO (Captura de Erro)
     // --------------------------------------------------------
     default:
-        std::cerr << ">>> ERRO FATAL: Opcode desconhecido: 0x" << std::hex << opcode
-                  << " (em PC=0x" << (pc-4) << ")" << std::dec << "\n";
+    {
+        uint32_t opcode = d.raw & 0x7F;
+        if (d.len == 2)
+            log_err() << ">>> ERRO FATAL: Instrução comprimida inválida: 0x" << std::hex << d.raw
+                      << " (em PC=0x" << (pc - 2) << ")" << std::dec << "\n";
+        else if (opcode == 0x73)
+            log_err() << "    -> EBREAK ou instrução SYSTEM desconhecida: 0x" << std::hex << d.raw << "\n";
+        else if (opcode == 0x13 || opcode == 0x33 || opcode == 0x03 || opcode == 0x23 || opcode == 0x63)
+            log_err() << "ERRO: Funct3 desconhecido para Opcode 0x" << std::hex << opcode << std::dec << "\n";
+        else
+            log_err() << ">>> ERRO FATAL: Opcode desconhecido: 0x" << std::hex << opcode
+                      << " (em PC=0x" << (pc - 4) << ")" << std::dec << "\n";
         running = false;
+        deadline = 0;
         break;
     }
+    }
 }
 
 // ============================================================
@@ -448,20 +1298,20 @@ void CPU::execute(uint32_t instr, Bus& bus)
 // ============================================================
 void CPU::print_registers()
 {
-    std::cout << "--- Estado dos Registradores ---\n";
-    std::cout << "PC: 0x" << std::hex << std::setw(8) << std::setfill('0') << pc << "\n";
+    log_out() << "--- Estado dos Registradores ---\n";
+    log_out() << "PC: 0x" << std::hex << std::setw(8) << std::setfill('0') << pc << "\n";
     for (int i = 0; i < 32; ++i)
     {
-        std::cout << "x" << i << " (" << get_abi_name(i) << "):\t0x"
+        log_out() << "x" << i << " (" << get_abi_name(i) << "):\t0x"
                   << std::hex << std::setw(8) << std::setfill('0') << regs[i]
                   << std::dec << " (" << static_cast<int32_t>(regs[i]) << ")\n";
     }
-    std::cout << "---------------------------------\n";
+    log_out() << "---------------------------------\n";
 }
 
 const char* CPU::get_abi_name(int i) const
 {
-    // Mapeamento padro RISC-V ABI
+    // Mapeamento padrão RISC-V ABI
     static const char* names[] =
     {
         "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
@@ -470,7 +1320,7 @@ const char* CPU::get_abi_name(int i) const
         "s8",   "s9", "s10","s11", "t3", "t4", "t5", "t6"
     };
 
-    // Voc pode adicionar a lgica para 'fp' se precisar do apelido
+    // Você pode adicionar a lógica para 'fp' se precisar do apelido
     if (i == 8) return "fp/s0"; // Ou apenas "s0"
 
     if (i >= 0 && i < 32) return names[i];
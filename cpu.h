@@ -6,6 +6,35 @@
 #include <iostream>
 #include <iomanip>
 #include "bus.h" // Necessário para a função run e fetch
+#include "icache.h"
+#include "block.h"
+#include "jit.h"
+#include "exectrace.h"
+
+class Profiler;
+
+// Bits de mstatus usados pelas interrupções do modo máquina
+const uint32_t MSTATUS_MIE  = 1u << 3; // Interrupções habilitadas
+const uint32_t MSTATUS_MPIE = 1u << 7; // MIE antes da trap (restaurado pelo MRET)
+
+// Motores de interpretação (selecionáveis em tempo de execução)
+enum ExecEngine {
+    ENGINE_SWITCH,   // fetch + switch sobre o OpId (referência)
+    ENGINE_THREADED, // "computed goto": cada handler salta para o próximo
+    ENGINE_BLOCKS,   // Blocos básicos traduzidos e encadeados
+    ENGINE_JIT       // ENGINE_BLOCKS + compilação x86-64 dos blocos quentes
+};
+
+// Eventos dos contadores programáveis (valor gravado em mhpmevent3..31)
+enum HpmEvent {
+    HPM_EVENT_NONE,         // Contador parado
+    HPM_EVENT_LOAD,         // LB/LH/LW/LBU/LHU que acessam o barramento (rd != x0)
+    HPM_EVENT_STORE,        // SB/SH/SW
+    HPM_EVENT_BRANCH_TAKEN, // Desvios condicionais tomados
+    HPM_EVENT_TRAP,         // Traps (ECALL e interrupções)
+    HPM_EVENT_CSR,          // Instruções CSRR*
+    HPM_EVENT_COUNT
+};
 
 class CPU {
 public:
@@ -20,21 +49,120 @@ public:
     uint32_t mcause;   // Causa da Trap
     uint32_t mstatus;  // Status da Máquina
     uint32_t mepc;     // PC da exceção
-    uint32_t mie;      // Interrupções Habilitadas (Machine)
+    uint32_t mie;      // Interrupções Habilitadas (Machine): MIP_MSIP / MIP_MTIP
     uint32_t medeleg;  // Delegação de Exceção
     uint32_t mideleg;  // Delegação de Interrupção
     uint32_t pmpaddr0; // Configuração de Proteção de Memória
     uint32_t pmpcfg0;  // Configuração de Proteção de Memória
     uint32_t satp;     // Page Table Base Address
-    uint32_t mhartid;  // ID do Core (sempre 0 para nós)
+    uint32_t mhartid;  // ID do Core (0, ou o índice do hart com --harts)
     // --- FIM DOS CSRs ---
 
+    // --- Contadores de desempenho (mcycle/minstret/time e mhpmcounter) ---
+    // O caminho rápido só conta ciclos ('cycle_count', que volta a zero a
+    // cada 'run') e os eventos em 'hpm_events'; os CSRs de 64 bits são
+    // calculados na leitura: contagem + deslocamento gravado pelo guest.
+    // Uma instrução = um ciclo = um tick do 'time'; os ciclos parados em
+    // WFI ('idle_cycles') contam em mcycle/time, mas não em minstret.
+    static const int HPM_COUNTERS = 29; // mhpmcounter3..31
+    uint64_t cycle_base;      // Ciclos antes do 'run' atual
+    uint64_t idle_cycles;     // Ciclos parados em WFI desde o 'reset'
+    uint64_t mcycle_offset;   // mcycle = cycles() + mcycle_offset
+    uint64_t minstret_offset; // minstret = instret() + minstret_offset
+    uint64_t hpm_events[HPM_EVENT_COUNT]; // Contagem bruta de cada HpmEvent
+    uint32_t mhpmevent[HPM_COUNTERS];     // Evento de cada mhpmcounter (WARL: < HPM_EVENT_COUNT)
+    uint64_t hpm_offset[HPM_COUNTERS];    // mhpmcounter = evento + deslocamento
+
+    // Ciclos e instruções concluídas desde o 'reset' (64 bits)
+    uint64_t cycles() const { return cycle_base + (uint32_t)cycle_count; }
+    uint64_t instret() const { return cycles() - idle_cycles; }
+    // hpm_events[HPM_EVENT_NONE] fica sempre em 0 (contador parado)
+    uint64_t hpm_counter(int i) const { return hpm_events[mhpmevent[i]] + hpm_offset[i]; }
+
+    // Reserva do LR.W (uma por hart): endereço e valor lido. O SC.W grava
+    // com um CAS contra esse valor, então não há trava global; uma
+    // reserva "ABA" (a palavra voltou ao mesmo valor) é aceita.
+    uint32_t reservation_addr;
+    uint32_t reservation_value;
+    bool reservation_valid;
+    uint64_t atomics; // LR/SC/AMOs executadas (estatística)
+
+    // Cache de instruções decodificadas (indexada pelo PC)
+    DecodeCache icache;
+
+    // Cache de blocos básicos (usada pelo ENGINE_BLOCKS)
+    BlockCache blocks;
+
+    // Motor usado por 'run' (padrão: ENGINE_SWITCH)
+    ExecEngine engine;
+
+    // JIT (ENGINE_JIT): blocos executados 'jit_threshold' vezes são compilados
+    JitCompiler jit;
+    int jit_threshold;
+
+    // Últimas instruções concluídas (relatórios de falha). Os motores
+    // apontam 'trace_entry' para a entrada da instrução em execução, onde
+    // LOAD/STORE/atômicas gravam endereço e dado. Sempre por 'trace_begin'
+    // e afins, que somem sem EXEC_TRACE.
+    TraceRing trace;
+    TraceEntry* trace_entry;
+    void trace_begin(uint32_t at, uint32_t raw) { if (EXEC_TRACE) trace_entry = trace.next(at, raw); }
+    void trace_result(uint32_t value) { if (EXEC_TRACE) trace_entry->value = value; }
+    void trace_access(uint32_t addr) { if (EXEC_TRACE) trace_entry->addr = addr; }
+    void trace_access(uint32_t addr, uint32_t data) {
+        if (EXEC_TRACE) { trace_entry->addr = addr; trace_entry->data = data; }
+    }
+
+    // Perfilador (--profile): se definido, 'run' conta cada instrução nele
+    // com o laço do motor switch, qualquer que seja 'engine'
+    Profiler* profiler;
+
+    // --- Agendador de eventos ---
+    // Os motores rodam em linha reta até 'cycle_count' chegar a 'deadline'
+    // (limite de ciclos, próxima interrupção de timer ou, no máximo,
+    // SERVICE_INTERVAL ciclos); só então 'service_events' atende o
+    // 'tohost', o relógio do CLINT, as interrupções e o WFI. Quem muda o
+    // que o agendador calculou (escrita em MMIO, mstatus/mie, MRET, WFI,
+    // erro fatal) zera 'deadline' para forçar um ponto de serviço.
+    static const int SERVICE_INTERVAL = 4096; // Outros harts (tohost, msip) e o mtime do MMIO
+    int deadline;
+    bool waiting;        // Parado em WFI até uma interrupção pendente
+    uint64_t time_offset;     // time = cycles() + time_offset
+    uint32_t time_generation; // Última gravação do guest em mtime já aplicada
+    uint64_t interrupts; // Interrupções atendidas (estatística)
+    Clint* clint;        // CLINT da máquina (definido por 'run_slice')
+    uint32_t hart_count; // Harts da máquina (boot_hart); com 1, nada muda a RAM por fora
+    bool free_running;   // Harts livres (run_smp): WFI e laços não passam do tempo dos outros
+
+    // --- Laços sem efeitos ("j ." e espera ativa numa posição da RAM) ---
+    // Detectados nos pontos de serviço: as voltas até o próximo evento
+    // são puladas; sem evento possível, o hart para com 'infinite_loop'
+    static constexpr int SPIN_PROBE_LIMIT = 8;  // Instruções por volta, no máximo
+    static constexpr int SPIN_BACKOFF_MAX = 16; // Pontos de serviço entre sondagens num laço comum
+    bool infinite_loop;    // Parou num laço (ou WFI) do qual nada o tira
+    uint64_t spin_skipped; // Instruções puladas em laços sem efeitos (estatística)
+    uint32_t spin_pc;      // Onde começou a última sondagem que falhou
+    int spin_backoff;      // Pontos de serviço até a próxima sondagem perto de 'spin_pc'...
+    int spin_countdown;    // ... e quantos ainda faltam
+
+    // Tempo atual (CSR 'time' e o timer deste hart)
+    uint64_t time_now() const { return cycles() + time_offset; }
+    // Bits de mip (MIP_MSIP / MIP_MTIP) do CLINT para este hart
+    uint32_t pending_interrupts() const;
 
     CPU();
+    void reset(); // Registradores, PC e CSRs de power-on; esvazia as caches
     uint32_t fetch(Bus& bus);
+    const DecodedInstr& fetch_decoded(Bus& bus);
     void execute(uint32_t instr, Bus& bus);
+    void execute(const DecodedInstr& d, Bus& bus);
     void print_registers();
     void run(Bus& bus, int max_cycles = 50000);
+    // Como 'run', mas sem zerar 'cycle_count' (continua de um snapshot);
+    // 'max_cycles' é o total, contando os ciclos já executados
+    void resume(Bus& bus, int max_cycles = 50000);
+    // Só o laço do motor, sem banners nem resumo (fatias do modo --batch)
+    void run_slice(Bus& bus, int max_cycles);
     void setPC(uint32_t new_pc);
 
     // Funções auxiliares:
@@ -44,9 +172,33 @@ public:
     // Funções auxiliares para CSR
     uint32_t read_csr(uint32_t addr);
     void write_csr(uint32_t addr, uint32_t value);
+    // Zera 'cycle_count' sem perder os ciclos já contados nos CSRs
+    void restart_cycles() { cycle_base += (uint32_t)cycle_count; cycle_count = 0; }
 
 private:
-    // Opcional: Se houver funções privadas, elas permanecem aqui.
+    DecodedInstr uncached; // Usada quando o PC está fora da RAM (não cacheável)
+
+    // Motores: executam até 'cycle_count' chegar a 'deadline'
+    void run_switch(Bus& bus);
+    void run_threaded(Bus& bus);
+    void run_blocks(Bus& bus);
+    void run_profiled(Bus& bus);
+
+    // Ponto de serviço entre duas linhas retas: false = a execução para
+    bool service_events(Bus& bus, int max_cycles);
+    void sync_clock();
+    void take_interrupt(uint32_t pending);
+    bool wait_for_interrupt(int max_cycles);
+    void schedule(int max_cycles);
+    int64_t cycles_to_event(int max_cycles, bool timer) const;
+    uint64_t others_time() const;
+    int64_t limit_to_others(int64_t cycles, uint64_t slack);
+    void stop_forever(const char* what);
+    bool check_atomic_address(Bus& bus, const DecodedInstr& d, uint32_t addr);
+
+    bool spin_probe_due();
+    int probe_spin_loop(Bus& bus, int max_cycles, uint64_t* events);
+    bool skip_spin_loop(int length, const uint64_t* events, int max_cycles);
 };
 
 #endif // CPU_H
@@ -0,0 +1,153 @@
+#include "exectrace.h"
+#include "cpu.h"
+#include "icache.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// ============================================================
+//  ANEL
+// ============================================================
+void TraceRing::resize(uint32_t depth)
+{
+    enabled = EXEC_TRACE && depth > 0;
+    uint32_t size = 1;
+    while (size < depth && size < (1u << 24)) size <<= 1;
+    entries.assign(size, TraceEntry());
+    mask = size - 1;
+    pos = 0;
+}
+
+void TraceRing::ordered(std::vector<TraceEntry>& out) const
+{
+    out.clear();
+    if (!enabled) return;
+    uint64_t count = pos < entries.size() ? pos : entries.size();
+    for (uint64_t i = pos - count; i < pos; ++i) out.push_back(entries[i & mask]);
+}
+
+// ============================================================
+//  RELATÓRIO (texto)
+// ============================================================
+namespace {
+
+bool writes_rd(uint8_t op)
+{
+    switch (op) {
+    case OP_SB: case OP_SH: case OP_SW:
+    case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+    case OP_FENCE: case OP_FENCE_I: case OP_ECALL: case OP_MRET: case OP_WFI:
+    case OP_NOP: case OP_ILLEGAL:
+        return false;
+    default:
+        return true;
+    }
+}
+
+std::string hex32(uint32_t value)
+{
+    std::ostringstream s;
+    s << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+    return s.str();
+}
+
+// Efeito da instrução: registrador de destino, acesso à memória, desvio
+std::string effect(const CPU& cpu, const TraceEntry& e, const DecodedInstr& d, const TraceEntry* next)
+{
+    std::ostringstream s;
+    bool rd = writes_rd(d.op) && d.rd != 0;
+    if (rd) s << cpu.get_abi_name(d.rd) << " = " << hex32(e.value);
+
+    if (d.op >= OP_LB && d.op <= OP_LHU) {
+        s << (rd ? " <- " : "") << "mem[" << hex32(e.addr) << "]";
+    } else if (d.op >= OP_SB && d.op <= OP_SW) {
+        uint32_t data = d.op == OP_SB ? (e.data & 0xFF) : d.op == OP_SH ? (e.data & 0xFFFF) : e.data;
+        s << "mem[" << hex32(e.addr) << "] <- " << hex32(data);
+    } else if (d.op >= OP_LR_W && d.op <= OP_AMOMAXU_W) {
+        s << (rd ? " | " : "") << "mem[" << hex32(e.addr) << "]";
+        if (d.op != OP_LR_W) s << " (operando " << hex32(e.data) << ")";
+    } else if (d.op >= OP_BEQ && d.op <= OP_BGEU && next) {
+        s << (next->pc != e.pc + d.len ? "tomado" : "não tomado");
+    } else if (d.op == OP_ECALL && next) {
+        s << "trap -> " << hex32(next->pc & ~1u);
+    }
+    return s.str();
+}
+
+} // namespace
+
+void write_trace_text(std::ostream& out, const CPU& cpu)
+{
+    std::vector<TraceEntry> entries;
+    cpu.trace.ordered(entries);
+    if (entries.empty()) {
+        out << (EXEC_TRACE ? "(trace desligado: --trace-depth=0)\n"
+                           : "(trace removido na compilação: -DRISCV_EXEC_TRACE=0)\n");
+        return;
+    }
+
+    // Ciclo (instret) de cada entrada, contando para trás a partir da última
+    std::vector<uint64_t> cycle(entries.size());
+    uint64_t c = cpu.instret();
+    for (size_t i = entries.size(); i-- > 0;) {
+        c -= (entries[i].pc & 1) ? entries[i].raw : 1;
+        cycle[i] = c;
+    }
+
+    out << "     ciclo  PC          instrução   op         efeito\n";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const TraceEntry& e = entries[i];
+        const TraceEntry* next = i + 1 < entries.size() ? &entries[i + 1] : nullptr;
+        out << std::dec << std::setfill(' ') << std::setw(10) << cycle[i] << "  ";
+        if ((e.pc & 1) && e.addr == TRACE_GROUP_SPIN) {
+            out << hex32(e.pc & ~1u) << "  [LAÇO] voltas sem efeitos puladas: " << std::dec << e.raw
+                << " instruções\n";
+            continue;
+        }
+        if (e.pc & 1) {
+            out << hex32(e.pc & ~1u) << "  [JIT] bloco nativo: " << std::dec << e.raw
+                << " instruções, saída em " << hex32(e.value) << "\n";
+            continue;
+        }
+        DecodedInstr d = decode_instr(e.raw);
+        std::ostringstream raw;
+        raw << "0x" << std::hex << std::setfill('0') << std::setw(d.len == 2 ? 4 : 8) << e.raw;
+        std::string what = effect(cpu, e, d, next);
+        out << hex32(e.pc) << "  " << std::left << std::setw(10) << raw.str() << "  ";
+        if (what.empty()) out << op_name(d.op);
+        else out << std::setw(9) << op_name(d.op) << "  " << what;
+        out << std::right << "\n";
+    }
+}
+
+// ============================================================
+//  ARQUIVO BINÁRIO
+// ============================================================
+static void put32(std::ostream& out, uint32_t v)
+{
+    char b[4] = { (char)v, (char)(v >> 8), (char)(v >> 16), (char)(v >> 24) };
+    out.write(b, 4);
+}
+
+bool write_trace_binary(const std::string& filename, const CPU& cpu)
+{
+    std::vector<TraceEntry> entries;
+    cpu.trace.ordered(entries);
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) return false;
+    uint64_t last = cpu.instret() ? cpu.instret() - 1 : 0;
+    out.write("RVTR", 4);
+    put32(out, 1); // Versão
+    put32(out, (uint32_t)entries.size());
+    put32(out, (uint32_t)last);
+    put32(out, (uint32_t)(last >> 32));
+    for (const TraceEntry& e : entries) {
+        put32(out, e.pc);
+        put32(out, e.raw);
+        put32(out, e.value);
+        put32(out, e.addr);
+        put32(out, e.data);
+    }
+    return (bool)out;
+}
@@ -0,0 +1,96 @@
+#ifndef EXECTRACE_H
+#define EXECTRACE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class CPU;
+
+// O anel pode ser removido em tempo de compilação com -DRISCV_EXEC_TRACE=0
+// (alvo Release): os motores não gravam nada e os relatórios saem sem ele
+#ifndef RISCV_EXEC_TRACE
+#define RISCV_EXEC_TRACE 1
+#endif
+constexpr bool EXEC_TRACE = RISCV_EXEC_TRACE != 0;
+
+/**
+ * @struct TraceEntry
+ * @brief Uma instrução concluída no anel de trace. 'addr'/'data' só
+ * valem para LOAD/STORE/atômicas (o 'raw' diz qual foi a instrução).
+ *
+ * Entradas com o bit 0 do 'pc' ligado agrupam instruções que não passaram
+ * pelo anel: 'pc' = início | 1, 'raw' = instruções concluídas, 'value' =
+ * PC de saída e 'addr' = TRACE_GROUP_JIT (um bloco do código nativo do
+ * JIT) ou TRACE_GROUP_SPIN (voltas puladas de um laço sem efeitos).
+ */
+const uint32_t TRACE_GROUP_JIT  = 0;
+const uint32_t TRACE_GROUP_SPIN = 1;
+
+struct TraceEntry {
+    uint32_t pc;
+    uint32_t raw;   // Palavra da instrução (16 bits se comprimida)
+    uint32_t value; // rd depois da instrução
+    uint32_t addr;  // Endereço acessado
+    uint32_t data;  // Valor gravado (STORE / operando das atômicas)
+};
+
+/**
+ * @class TraceRing
+ * @brief Anel com as últimas 'depth' instruções concluídas, sempre
+ * ligado. Os motores gravam cada instrução com stores simples (sem
+ * desvio nem alocação) e os relatórios de falha o despejam no fim.
+ *
+ * 'depth' é potência de 2. Com 0 (desligado) o anel tem uma única
+ * entrada descartável, então os motores gravam do mesmo jeito, sem testar
+ * se o trace está ligado. Sem EXEC_TRACE, o anel fica sempre desligado e
+ * os motores nem gravam (CPU::trace_begin e afins).
+ */
+class TraceRing {
+public:
+    static const uint32_t DEFAULT_DEPTH = 256;
+
+    TraceRing() { resize(DEFAULT_DEPTH); }
+
+    // Arredonda para potência de 2 (0 = desligado); esvazia o anel
+    void resize(uint32_t depth);
+    void clear() { pos = 0; }
+
+    uint32_t depth() const { return enabled ? mask + 1 : 0; }
+
+    // Próxima entrada (já com PC e instrução); os motores preenchem o resto
+    TraceEntry* next(uint32_t pc, uint32_t raw) {
+        TraceEntry* e = &entries[pos++ & mask];
+        e->pc = pc;
+        e->raw = raw;
+        return e;
+    }
+
+    // Estado bruto para o laço do motor threaded (cópias locais)
+    TraceEntry* data() { return entries.data(); }
+    uint32_t mask;
+    uint64_t pos; // Entradas gravadas desde o último 'clear'
+
+    // Entradas válidas, da mais antiga para a mais recente
+    void ordered(std::vector<TraceEntry>& out) const;
+
+private:
+    std::vector<TraceEntry> entries;
+    bool enabled;
+};
+
+/**
+ * @brief Escreve as últimas instruções da CPU (uma por linha: ciclo, PC,
+ * instrução, mnemônico e o efeito: rd, endereço e dado).
+ */
+void write_trace_text(std::ostream& out, const CPU& cpu);
+
+/**
+ * @brief Grava o anel num arquivo binário compacto: cabeçalho "RVTR",
+ * versão, número de entradas e ciclo da última (little-endian), seguido
+ * das entradas (5 palavras cada) da mais antiga para a mais recente.
+ */
+bool write_trace_binary(const std::string& filename, const CPU& cpu);
+
+#endif // EXECTRACE_H
@@ -0,0 +1,237 @@
+#include "htif.h"
+#include "bus.h"
+#include "trace.h"
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define RISCV_HAVE_READ 1
+#endif
+
+// Erros devolvidos ao guest (-errno, valores do Linux/newlib)
+static const int32_t GUEST_EIO    = 5;
+static const int32_t GUEST_EBADF  = 9;
+static const int32_t GUEST_EFAULT = 14;
+static const int32_t GUEST_EINVAL = 22;
+static const int32_t GUEST_EMFILE = 24;
+static const int32_t GUEST_ENOSYS = 38;
+
+// Flags de 'open' da newlib (as que o libgloss do RISC-V repassa)
+static const uint32_t GUEST_O_ACCMODE = 0x3;
+static const uint32_t GUEST_O_RDWR    = 0x2;
+static const uint32_t GUEST_O_APPEND  = 0x0008;
+static const uint32_t GUEST_O_CREAT   = 0x0200;
+static const uint32_t GUEST_O_TRUNC   = 0x0400;
+
+// Maior transferência de um 'read'/'write' (o guest recebe a contagem parcial)
+static const uint32_t MAX_TRANSFER = 1u << 20;
+
+Htif::Htif()
+    : quiet(false),
+      exited(false),
+      exit_code(0),
+      syscalls(0),
+      console_bytes(0),
+      record_input(false),
+      replay_input(nullptr),
+      files(MAX_FILES, nullptr),
+      replay_pos(0)
+{
+}
+
+Htif::~Htif()
+{
+    flush();
+    close_files();
+}
+
+void Htif::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    console.clear();
+    close_files();
+    exited = false;
+    exit_code = 0;
+    syscalls = 0;
+    console_bytes = 0;
+    input_log.clear();
+    replay_pos = 0;
+}
+
+void Htif::close_files()
+{
+    for (uint32_t fd = 3; fd < MAX_FILES; ++fd) {
+        if (files[fd]) std::fclose(files[fd]);
+        files[fd] = nullptr;
+    }
+}
+
+void Htif::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    flush_locked();
+}
+
+void Htif::flush_locked()
+{
+    if (console.empty()) return;
+    if (!quiet) {
+        log_out().write(console.data(), (std::streamsize)console.size());
+        log_out().flush();
+    }
+    console.clear();
+}
+
+// ============================================================
+//  PEDIDOS (bloco 'magic_mem' na RAM do guest)
+// ============================================================
+bool Htif::service(Bus& bus, uint32_t block)
+{
+    // Os argumentos usados ([0] a [4]) têm de estar na RAM: um pedido
+    // apontando para MMIO teria efeitos colaterais
+    if ((block & 7) || !bus.isRamAccess(block, 4) || !bus.isRamAccess(block + 36, 4))
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t args[5];
+    for (int i = 0; i < 5; ++i) args[i] = bus.readWord(block + 8 * i);
+    int32_t result = dispatch(bus, args);
+    bus.writeWord(block, (uint32_t)result);
+    bus.writeWord(block + 4, result < 0 ? 0xFFFFFFFFu : 0);
+    syscalls++;
+    return true;
+}
+
+int32_t Htif::dispatch(Bus& bus, const uint32_t* args)
+{
+    switch (args[0]) {
+    case HTIF_SYS_WRITE:  return sys_write(bus, args[1], args[2], args[3]);
+    case HTIF_SYS_READ:   return sys_read(bus, args[1], args[2], args[3]);
+    case HTIF_SYS_OPENAT: return sys_open(bus, args[2], args[3]); // O diretório é sempre o atual
+    case HTIF_SYS_OPEN:   return sys_open(bus, args[1], args[2]);
+    case HTIF_SYS_CLOSE:  return sys_close(args[1]);
+    case HTIF_SYS_EXIT:
+        exited = true;
+        exit_code = args[1];
+        return 0;
+    default:
+        if (!quiet) TRACE(TRACE_SUMMARY, "[HTIF] Chamada de sistema " << args[0] << " não suportada\n");
+        return -GUEST_ENOSYS;
+    }
+}
+
+// Copia [buf, buf + len) do guest; false se algum byte não estiver na RAM
+static bool copy_from_guest(Bus& bus, uint32_t buf, uint32_t len, std::string& out)
+{
+    out.resize(len);
+    for (uint32_t i = 0; i < len; ++i) {
+        if (!bus.isRamAccess(buf + i, 1)) return false;
+        out[i] = (char)bus.readByte(buf + i);
+    }
+    return true;
+}
+
+int32_t Htif::sys_write(Bus& bus, uint32_t fd, uint32_t buf, uint32_t len)
+{
+    if (fd >= MAX_FILES || fd == 0 || (fd > 2 && !files[fd])) return -GUEST_EBADF;
+    len = std::min(len, MAX_TRANSFER);
+    std::string data;
+    if (!copy_from_guest(bus, buf, len, data)) return -GUEST_EFAULT;
+
+    if (fd == 1) {
+        console += data;
+        console_bytes += len;
+        if (console.size() >= CONSOLE_BUFFER) flush_locked();
+        return (int32_t)len;
+    }
+    if (fd == 2) {
+        // Sem buffer, mas depois do que o fd 1 já escreveu
+        flush_locked();
+        console_bytes += len;
+        if (!quiet) log_err().write(data.data(), (std::streamsize)len).flush();
+        return (int32_t)len;
+    }
+    size_t written = std::fwrite(data.data(), 1, len, files[fd]);
+    if (written == 0 && len) return -GUEST_EIO;
+    return (int32_t)written;
+}
+
+int32_t Htif::sys_read(Bus& bus, uint32_t fd, uint32_t buf, uint32_t len)
+{
+    std::FILE* file = (fd == 0) ? stdin : (fd > 2 && fd < MAX_FILES ? files[fd] : nullptr);
+    if (!file) return -GUEST_EBADF;
+    len = std::min(len, MAX_TRANSFER);
+    for (uint32_t i = 0; i < len; ++i)
+        if (!bus.isRamAccess(buf + i, 1)) return -GUEST_EFAULT;
+
+    std::string data;
+    if (fd == 0 && replay_input) {
+        // Reexecução: a mesma leitura que a referência fez (vazia = fim)
+        if (replay_pos < replay_input->size()) data = (*replay_input)[replay_pos++];
+    } else if (fd == 0) {
+        flush_locked(); // O guest pode estar esperando uma resposta ao que escreveu
+        data.assign(len, '\0');
+#ifdef RISCV_HAVE_READ
+        // Como o 'read' de verdade: espera só o primeiro byte e devolve o
+        // que já chegou (o fread esperaria 'len' bytes de um terminal)
+        ssize_t got = ::read(0, &data[0], len);
+        if (got < 0) return -GUEST_EIO;
+#else
+        size_t got = std::fread(&data[0], 1, len, file);
+        if (got == 0 && std::ferror(file)) return -GUEST_EIO;
+#endif
+        data.resize((size_t)got);
+        if (record_input) input_log.push_back(data);
+    } else {
+        data.assign(len, '\0');
+        size_t got = std::fread(&data[0], 1, len, file);
+        if (got == 0 && std::ferror(file)) return -GUEST_EIO;
+        data.resize(got);
+    }
+    for (size_t i = 0; i < data.size(); ++i) bus.writeByte(buf + (uint32_t)i, (uint8_t)data[i]);
+    return (int32_t)data.size();
+}
+
+int32_t Htif::sys_open(Bus& bus, uint32_t path, uint32_t flags)
+{
+    std::string name;
+    for (uint32_t i = 0;; ++i) {
+        if (i == MAX_PATH) return -GUEST_EINVAL;
+        if (!bus.isRamAccess(path + i, 1)) return -GUEST_EFAULT;
+        char c = (char)bus.readByte(path + i);
+        if (!c) break;
+        name += c;
+    }
+
+    uint32_t fd = 3;
+    while (fd < MAX_FILES && files[fd]) ++fd;
+    if (fd == MAX_FILES) return -GUEST_EMFILE;
+
+    // O modo do fopen mais próximo das flags
+    bool rdwr = (flags & GUEST_O_ACCMODE) == GUEST_O_RDWR;
+    std::FILE* file = nullptr;
+    errno = 0;
+    if ((flags & GUEST_O_ACCMODE) == 0) {
+        file = std::fopen(name.c_str(), "rb");
+    } else if (flags & GUEST_O_APPEND) {
+        file = std::fopen(name.c_str(), rdwr ? "a+b" : "ab");
+    } else if (flags & GUEST_O_TRUNC) {
+        file = std::fopen(name.c_str(), rdwr ? "w+b" : "wb");
+    } else {
+        file = std::fopen(name.c_str(), "r+b");
+        if (!file && (flags & GUEST_O_CREAT)) file = std::fopen(name.c_str(), "w+b");
+    }
+    if (!file) return -(errno ? errno : GUEST_EIO);
+    files[fd] = file;
+    return (int32_t)fd;
+}
+
+int32_t Htif::sys_close(uint32_t fd)
+{
+    if (fd <= 2) return 0; // Os descritores do console ficam abertos
+    if (fd >= MAX_FILES || !files[fd]) return -GUEST_EBADF;
+    std::fclose(files[fd]);
+    files[fd] = nullptr;
+    return 0;
+}
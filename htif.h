@@ -0,0 +1,82 @@
+#ifndef HTIF_H
+#define HTIF_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Bus;
+
+// Chamadas de sistema atendidas (números do Linux/newlib para RISC-V)
+const uint32_t HTIF_SYS_OPENAT = 56;
+const uint32_t HTIF_SYS_CLOSE  = 57;
+const uint32_t HTIF_SYS_READ   = 63;
+const uint32_t HTIF_SYS_WRITE  = 64;
+const uint32_t HTIF_SYS_EXIT   = 93;
+const uint32_t HTIF_SYS_OPEN   = 1024;
+
+/**
+ * @class Htif
+ * @brief Lado do host do HTIF: atende as chamadas de sistema que o guest
+ * pede pelo 'tohost' (ver Peripherals). O pedido é um bloco de 8 palavras
+ * de 64 bits na RAM do guest, como o 'magic_mem' do syscalls.c dos
+ * benchmarks do riscv-tests:
+ *
+ *   [0] número da chamada   [1..4] argumentos   -> [0] resultado
+ *
+ * Só a metade de baixo de cada palavra é lida (RV32); o resultado é
+ * gravado com sinal (erros são -errno). A saída padrão do guest (fd 1)
+ * fica num buffer e vai para o log em blocos de até CONSOLE_BUFFER bytes;
+ * o fd 2 descarrega o buffer e sai na hora. Os outros descritores são
+ * arquivos do host abertos pelo guest.
+ */
+class Htif {
+public:
+    static const uint32_t CONSOLE_BUFFER = 64 * 1024; // Bytes do fd 1 antes de ir para o log
+    static const uint32_t MAX_FILES = 64;             // Descritores do guest (0, 1 e 2 fixos)
+    static const uint32_t MAX_PATH = 1024;            // Caminho de 'open', com o '\0'
+
+    bool quiet;        // Descarta a saída do guest (reexecuções do --engine=check)
+    bool exited;       // O guest chamou 'exit'...
+    uint32_t exit_code; // ... com este código
+    uint64_t syscalls;      // Chamadas atendidas (estatística)
+    uint64_t console_bytes; // Bytes escritos nos fds 1 e 2 (estatística)
+
+    // --engine=check: a execução de referência guarda o que cada 'read' do
+    // fd 0 devolveu em 'input_log' (com 'record_input'); as reexecuções, que
+    // já não têm o stdin, recebem as mesmas leituras de 'replay_input'
+    bool record_input;
+    std::vector<std::string> input_log;
+    const std::vector<std::string>* replay_input;
+
+    Htif();
+    ~Htif();
+    void reset(); // Fecha os arquivos do guest e descarta o buffer e o stdin gravado
+
+    // Atende o pedido em 'block' pela porta 'bus' do hart que o fez.
+    // false = o bloco não está na RAM (pedido inválido)
+    bool service(Bus& bus, uint32_t block);
+    // Manda o buffer do fd 1 para o log (fim do programa, leitura do stdin)
+    void flush();
+
+private:
+    std::mutex mutex;             // Harts de threads diferentes (SMP)
+    std::string console;          // Saída do fd 1 ainda não escrita
+    std::vector<std::FILE*> files; // Índice = fd do guest (nullptr = livre)
+    size_t replay_pos;            // Próxima leitura de 'replay_input'
+
+    int32_t dispatch(Bus& bus, const uint32_t* args);
+    int32_t sys_write(Bus& bus, uint32_t fd, uint32_t buf, uint32_t len);
+    int32_t sys_read(Bus& bus, uint32_t fd, uint32_t buf, uint32_t len);
+    int32_t sys_open(Bus& bus, uint32_t path, uint32_t flags);
+    int32_t sys_close(uint32_t fd);
+    void flush_locked();
+    void close_files();
+
+    Htif(const Htif&) = delete;
+    Htif& operator=(const Htif&) = delete;
+};
+
+#endif // HTIF_H
@@ -0,0 +1,415 @@
+#include "icache.h"
+#include <algorithm>
+
+// ============================================================
+//  NOMES DAS OPERAÇÕES (Usados nos logs [EXEC])
+// ============================================================
+static const char* const OP_NAMES[OP_COUNT] = {
+    "???",
+    "ADDI", "SLTI", "SLTIU", "XORI", "ORI", "ANDI",
+    "SLLI", "SRLI", "SRAI",
+    "ADD", "SUB", "SLL", "SLT", "SLTU", "XOR",
+    "SRL", "SRA", "OR", "AND",
+    "MUL", "MULH", "MULHSU", "MULHU", "DIV", "DIVU", "REM", "REMU",
+    "LUI", "AUIPC",
+    "LB", "LH", "LW", "LBU", "LHU",
+    "SB", "SH", "SW",
+    "BEQ", "BNE", "BLT", "BGE", "BLTU", "BGEU",
+    "JAL", "JALR",
+    "FENCE", "FENCE.I", "ECALL", "MRET", "WFI",
+    "CSRRW", "CSRRS", "CSRRC", "CSRRWI", "CSRRSI", "CSRRCI",
+    "LR.W", "SC.W",
+    "AMOSWAP.W", "AMOADD.W", "AMOXOR.W", "AMOAND.W", "AMOOR.W",
+    "AMOMIN.W", "AMOMAX.W", "AMOMINU.W", "AMOMAXU.W",
+    "NOP", "ILLEGAL"
+};
+
+const char* op_name(uint8_t op)
+{
+    return op < OP_COUNT ? OP_NAMES[op] : "???";
+}
+
+// ============================================================
+//  DECODE – Extrai campos e imediatos uma única vez
+// ============================================================
+static DecodedInstr decode32(uint32_t instr)
+{
+    DecodedInstr d;
+    uint32_t opcode = instr & 0x7F;
+    uint32_t funct3 = (instr >> 12) & 0x7;
+    uint32_t funct7 = (instr >> 25) & 0x7F;
+
+    d.op  = OP_ILLEGAL;
+    d.rd  = (instr >> 7)  & 0x1F;
+    d.rs1 = (instr >> 15) & 0x1F;
+    d.rs2 = (instr >> 20) & 0x1F;
+    d.len = 4;
+    d.imm = 0;
+    d.raw = instr;
+
+    switch (opcode)
+    {
+    case 0x13: // TIPO I
+    {
+        static const uint8_t ops[8] = { OP_ADDI, OP_SLLI, OP_SLTI, OP_SLTIU, OP_XORI, OP_SRLI, OP_ORI, OP_ANDI };
+        d.imm = (int32_t)instr >> 20;
+        d.op = ops[funct3];
+        if (funct3 == 0x1 || funct3 == 0x5) d.imm &= 0x1F; // shamt
+        if (funct3 == 0x5) {
+            if (funct7 == 0x20) d.op = OP_SRAI;
+            else if (funct7 != 0x00) d.op = OP_NOP;
+        }
+        break;
+    }
+    case 0x33: // TIPO R
+    {
+        static const uint8_t ops[8] = { OP_ADD, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_OR, OP_AND };
+        static const uint8_t mul_ops[8] = { OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU };
+        if (funct7 == 0x01) { // RV32M
+            d.op = mul_ops[funct3];
+            break;
+        }
+        d.op = ops[funct3];
+        if (funct3 == 0x0 && funct7 == 0x20) d.op = OP_SUB;
+        if (funct3 == 0x5) {
+            if (funct7 == 0x20) d.op = OP_SRA;
+            else if (funct7 != 0x00) d.op = OP_NOP;
+        }
+        break;
+    }
+    case 0x37: // LUI
+        d.op = OP_LUI;
+        d.imm = (int32_t)(instr & 0xFFFFF000);
+        break;
+    case 0x17: // AUIPC
+        d.op = OP_AUIPC;
+        d.imm = (int32_t)(instr & 0xFFFFF000);
+        break;
+    case 0x03: // LOAD
+    {
+        static const uint8_t ops[8] = { OP_LB, OP_LH, OP_LW, OP_ILLEGAL, OP_LBU, OP_LHU, OP_ILLEGAL, OP_ILLEGAL };
+        d.op = ops[funct3];
+        d.imm = (int32_t)instr >> 20;
+        break;
+    }
+    case 0x23: // STORE
+    {
+        static const uint8_t ops[8] = { OP_SB, OP_SH, OP_SW, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL };
+        d.op = ops[funct3];
+        d.imm = (((int32_t)instr >> 25) << 5) | ((instr >> 7) & 0x1F);
+        break;
+    }
+    case 0x63: // BRANCH
+    {
+        static const uint8_t ops[8] = { OP_BEQ, OP_BNE, OP_ILLEGAL, OP_ILLEGAL, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU };
+        d.op = ops[funct3];
+        d.imm = (((int32_t)instr >> 31) << 12) |
+                (((instr >> 7) & 0x1) << 11) |
+                (((instr >> 25) & 0x3F) << 5) |
+                (((instr >> 8) & 0xF) << 1);
+        break;
+    }
+    case 0x6F: // JAL
+        d.op = OP_JAL;
+        d.imm = (((int32_t)instr >> 31) << 20) |
+                (((instr >> 12) & 0xFF) << 12) |
+                (((instr >> 20) & 0x1) << 11) |
+                (((instr >> 21) & 0x3FF) << 1);
+        break;
+    case 0x67: // JALR
+        d.op = OP_JALR;
+        d.imm = (int32_t)instr >> 20;
+        break;
+    case 0x0F: // FENCE / FENCE.I
+        d.op = (funct3 == 0x1) ? OP_FENCE_I : OP_FENCE;
+        break;
+    case 0x2F: // ATÔMICAS (RV32A, só .W)
+    {
+        uint32_t funct5 = instr >> 27; // Os bits aq/rl (26:25) são ignorados:
+        if (funct3 != 0x2) break;      // toda atômica já é sequencialmente consistente
+        switch (funct5)
+        {
+        case 0x02: if (d.rs2 == 0) d.op = OP_LR_W; break;
+        case 0x03: d.op = OP_SC_W; break;
+        case 0x01: d.op = OP_AMOSWAP_W; break;
+        case 0x00: d.op = OP_AMOADD_W; break;
+        case 0x04: d.op = OP_AMOXOR_W; break;
+        case 0x0C: d.op = OP_AMOAND_W; break;
+        case 0x08: d.op = OP_AMOOR_W; break;
+        case 0x10: d.op = OP_AMOMIN_W; break;
+        case 0x14: d.op = OP_AMOMAX_W; break;
+        case 0x18: d.op = OP_AMOMINU_W; break;
+        case 0x1C: d.op = OP_AMOMAXU_W; break;
+        }
+        break;
+    }
+    case 0x73: // SISTEMA
+    {
+        static const uint8_t ops[8] = { OP_ILLEGAL, OP_CSRRW, OP_CSRRS, OP_CSRRC, OP_NOP, OP_CSRRWI, OP_CSRRSI, OP_CSRRCI };
+        d.imm = (instr >> 20) & 0xFFF; // Endereço do CSR
+        d.op = ops[funct3];
+        if (instr == 0x00000073) d.op = OP_ECALL;
+        else if (instr == 0x30200073) d.op = OP_MRET;
+        else if (instr == 0x10500073) d.op = OP_WFI;
+        break;
+    }
+    default:
+        break; // OP_ILLEGAL
+    }
+    return d;
+}
+
+DecodedInstr decode_instr(uint32_t instr)
+{
+    if ((instr & 3) == 3) return decode32(instr);
+
+    // RV32C: decodifica a forma expandida e corrige PC/tamanho
+    DecodedInstr d = decode32(expand_compressed(instr & 0xFFFF));
+    d.len = 2;
+    d.raw = instr & 0xFFFF;
+    switch (d.op)
+    {
+    case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+    case OP_JAL:
+        d.imm += 2; // Alvo = (pc - 4) + imm com pc = endereço + 2
+        break;
+    }
+    return d;
+}
+
+// ============================================================
+//  RV32C – Expansão das instruções comprimidas
+// ============================================================
+// Montagem das formas de 32 bits (mesmos campos do decode acima)
+static uint32_t enc_i(int32_t imm, uint32_t rs1, uint32_t f3, uint32_t rd, uint32_t op)
+{
+    return ((uint32_t)imm << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op;
+}
+static uint32_t enc_r(uint32_t f7, uint32_t rs2, uint32_t rs1, uint32_t f3, uint32_t rd)
+{
+    return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | 0x33;
+}
+static uint32_t enc_s(int32_t imm, uint32_t rs2, uint32_t rs1)
+{
+    return (((uint32_t)imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (0x2 << 12) |
+           (((uint32_t)imm & 0x1F) << 7) | 0x23;
+}
+static uint32_t enc_b(int32_t imm, uint32_t rs1, uint32_t f3)
+{
+    uint32_t u = (uint32_t)imm;
+    return (((u >> 12) & 1) << 31) | (((u >> 5) & 0x3F) << 25) | (rs1 << 15) | (f3 << 12) |
+           (((u >> 1) & 0xF) << 8) | (((u >> 11) & 1) << 7) | 0x63;
+}
+static uint32_t enc_j(int32_t imm, uint32_t rd)
+{
+    uint32_t u = (uint32_t)imm;
+    return (((u >> 20) & 1) << 31) | (((u >> 1) & 0x3FF) << 21) | (((u >> 11) & 1) << 20) |
+           (((u >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F;
+}
+
+// Extensão de sinal do campo de 'bits' bits em 'value'
+static int32_t sext(uint32_t value, int bits)
+{
+    return (int32_t)(value << (32 - bits)) >> (32 - bits);
+}
+
+uint32_t expand_compressed(uint32_t c)
+{
+    const uint32_t funct3 = (c >> 13) & 0x7;
+    const uint32_t rd  = (c >> 7) & 0x1F;   // rd/rs1 (formas CR/CI)
+    const uint32_t rs2 = (c >> 2) & 0x1F;
+    const uint32_t rdp = ((c >> 2) & 0x7) + 8;  // rd'/rs2' (x8-x15)
+    const uint32_t rs1p = ((c >> 7) & 0x7) + 8; // rs1'
+    // imm[5] = c[12], imm[4:0] = c[6:2] (C.ADDI, C.LI, C.ANDI, shamt)
+    const int32_t imm6 = sext(((c >> 7) & 0x20) | ((c >> 2) & 0x1F), 6);
+
+    switch (c & 3)
+    {
+    case 0: // Quadrante 0
+        switch (funct3)
+        {
+        case 0: // C.ADDI4SPN: addi rd', x2, nzuimm
+        {
+            uint32_t imm = ((c >> 7) & 0x30) | ((c >> 1) & 0x3C0) | ((c >> 4) & 0x4) | ((c >> 2) & 0x8);
+            return imm ? enc_i(imm, 2, 0, rdp, 0x13) : 0;
+        }
+        case 2: // C.LW: lw rd', uimm(rs1')
+        {
+            uint32_t imm = ((c >> 7) & 0x38) | ((c >> 4) & 0x4) | ((c << 1) & 0x40);
+            return enc_i(imm, rs1p, 2, rdp, 0x03);
+        }
+        case 6: // C.SW: sw rs2', uimm(rs1')
+        {
+            uint32_t imm = ((c >> 7) & 0x38) | ((c >> 4) & 0x4) | ((c << 1) & 0x40);
+            return enc_s(imm, rdp, rs1p);
+        }
+        default: return 0; // C.FLD/C.FLW/C.FSD/C.FSW (sem F/D) e reservados
+        }
+
+    case 1: // Quadrante 1
+        switch (funct3)
+        {
+        case 0: return enc_i(imm6, rd, 0, rd, 0x13); // C.ADDI / C.NOP
+        case 1: // C.JAL (RV32): jal x1, offset
+        case 5: // C.J: jal x0, offset
+        {
+            uint32_t off = ((c >> 1) & 0x800) | ((c >> 7) & 0x10) | ((c >> 1) & 0x300) |
+                           ((c << 2) & 0x400) | ((c >> 1) & 0x40) | ((c << 1) & 0x80) |
+                           ((c >> 2) & 0xE) | ((c << 3) & 0x20);
+            return enc_j(sext(off, 12), funct3 == 1 ? 1 : 0);
+        }
+        case 2: return enc_i(imm6, 0, 0, rd, 0x13); // C.LI: addi rd, x0, imm
+        case 3:
+            if (rd == 2) { // C.ADDI16SP: addi x2, x2, nzimm
+                uint32_t imm = ((c >> 3) & 0x200) | ((c >> 2) & 0x10) | ((c << 1) & 0x40) |
+                               ((c << 4) & 0x180) | ((c << 3) & 0x20);
+                return imm ? enc_i(sext(imm, 10), 2, 0, 2, 0x13) : 0;
+            }
+            // C.LUI: lui rd, nzimm (nzimm = 0 é reservado)
+            if (imm6 == 0) return 0;
+            return ((uint32_t)imm6 << 12) | (rd << 7) | 0x37;
+        case 4: // Operações da ULA sobre rd'
+        {
+            uint32_t r = rs1p;
+            switch ((c >> 10) & 0x3)
+            {
+            case 0: return (c & 0x1000) ? 0 : enc_i(imm6 & 0x1F, r, 5, r, 0x13);          // C.SRLI
+            case 1: return (c & 0x1000) ? 0 : enc_i((imm6 & 0x1F) | 0x400, r, 5, r, 0x13); // C.SRAI
+            case 2: return enc_i(imm6, r, 7, r, 0x13);                                      // C.ANDI
+            default:
+            {
+                if (c & 0x1000) return 0; // C.SUBW/C.ADDW: só RV64
+                static const uint32_t f3s[4] = { 0, 4, 6, 7 }; // C.SUB, C.XOR, C.OR, C.AND
+                uint32_t op2 = (c >> 5) & 0x3;
+                return enc_r(op2 == 0 ? 0x20 : 0, rdp, r, f3s[op2], r);
+            }
+            }
+        }
+        case 6: // C.BEQZ / C.BNEZ: beq/bne rs1', x0, offset
+        case 7:
+        {
+            uint32_t off = ((c >> 4) & 0x100) | ((c >> 7) & 0x18) | ((c << 1) & 0xC0) |
+                           ((c >> 2) & 0x6) | ((c << 3) & 0x20);
+            return enc_b(sext(off, 9), rs1p, funct3 == 6 ? 0 : 1);
+        }
+        }
+        break;
+
+    case 2: // Quadrante 2
+        switch (funct3)
+        {
+        case 0: // C.SLLI: slli rd, rd, shamt
+            return (c & 0x1000) ? 0 : enc_i(imm6 & 0x1F, rd, 1, rd, 0x13);
+        case 2: // C.LWSP: lw rd, uimm(x2) (rd = x0 é reservado)
+        {
+            uint32_t imm = ((c >> 7) & 0x20) | ((c >> 2) & 0x1C) | ((c << 4) & 0xC0);
+            return rd ? enc_i(imm, 2, 2, rd, 0x03) : 0;
+        }
+        case 4:
+            if (!(c & 0x1000)) {
+                if (rs2 == 0) return rd ? enc_i(0, rd, 0, 0, 0x67) : 0; // C.JR: jalr x0, 0(rs1)
+                return enc_r(0, rs2, 0, 0, rd);                         // C.MV: add rd, x0, rs2
+            }
+            if (rs2 == 0) {
+                if (rd == 0) return 0x00100073;  // C.EBREAK
+                return enc_i(0, rd, 0, 1, 0x67); // C.JALR: jalr x1, 0(rs1)
+            }
+            return enc_r(0, rs2, rd, 0, rd);     // C.ADD: add rd, rd, rs2
+        case 6: // C.SWSP: sw rs2, uimm(x2)
+        {
+            uint32_t imm = ((c >> 7) & 0x3C) | ((c >> 1) & 0xC0);
+            return enc_s(imm, rs2, 2);
+        }
+        default: return 0; // C.FLDSP/C.FLWSP/C.FSDSP/C.FSWSP (sem F/D)
+        }
+    }
+    return 0;
+}
+
+// ============================================================
+//  CACHE DE DECODIFICAÇÃO
+// ============================================================
+DecodeCache::DecodeCache()
+    : hits(0), misses(0),
+      ram_size(MAIN_RAM_SIZE),
+      pages((MAIN_RAM_SIZE + (1u << PAGE_SHIFT) - 1) >> PAGE_SHIFT),
+      owned(pages.size()),
+      origin(nullptr)
+{
+}
+
+void DecodeCache::resize(uint32_t new_size)
+{
+    if (new_size == ram_size) return;
+    ram_size = new_size;
+    origin = nullptr;
+    size_t count = ((uint64_t)new_size + (1u << PAGE_SHIFT) - 1) >> PAGE_SHIFT;
+    pages.assign(count, nullptr);
+    owned.clear();
+    owned.resize(count);
+}
+
+void DecodeCache::flush()
+{
+    origin = nullptr;
+    std::fill(pages.begin(), pages.end(), nullptr);
+    for (auto& page : owned) page.reset();
+}
+
+void DecodeCache::invalidate_page(uint32_t addr)
+{
+    uint32_t local = addr - MAIN_RAM_START;
+    if (local >= ram_size) return;
+    detach();
+    pages[local >> PAGE_SHIFT] = nullptr;
+    owned[local >> PAGE_SHIFT].reset();
+}
+
+// ============================================================
+//  COMPARTILHAMENTO ENTRE MÁQUINAS COM A MESMA IMAGEM
+// ============================================================
+void DecodeCache::share(DecodeCache* source)
+{
+    flush();
+    if (source && source != this && source->ram_size == ram_size && !source->origin)
+        origin = source;
+}
+
+DecodedInstr* DecodeCache::attach(uint32_t index)
+{
+    if (origin) {
+        DecodedInstr* page = origin->pages[index];
+        if (!page) page = origin->attach(index);
+        return pages[index] = page;
+    }
+    owned[index].reset(new DecodedInstr[PAGE_ENTRIES]()); // op = OP_UNDECODED
+    return pages[index] = owned[index].get();
+}
+
+DecodedInstr* DecodeCache::claim(uint32_t index)
+{
+    DecodedInstr* page = new DecodedInstr[PAGE_ENTRIES]();
+    if (pages[index])
+        std::copy(pages[index], pages[index] + PAGE_ENTRIES, page);
+    owned[index].reset(page);
+    return pages[index] = page;
+}
+
+// Instrução de 32 bits nos 2 últimos bytes da página, escrita pela
+// primeira palavra da página seguinte
+void DecodeCache::invalidate_last(uint32_t index)
+{
+    DecodedInstr* page = pages[index];
+    if (origin && (!page || page != owned[index].get()))
+        page = claim(index);
+    if (page) page[PAGE_ENTRIES - 1].op = OP_UNDECODED;
+}
+
+// Volta a ser uma cache comum, só com as páginas próprias
+void DecodeCache::detach()
+{
+    if (!origin) return;
+    for (size_t i = 0; i < pages.size(); ++i)
+        if (pages[i] != owned[i].get()) pages[i] = nullptr;
+    origin = nullptr;
+}
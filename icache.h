@@ -0,0 +1,166 @@
+#ifndef ICACHE_H
+#define ICACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ram.h" // MAIN_RAM_START / MAIN_RAM_SIZE
+
+// ============================================================
+//  IDENTIFICADORES DE OPERAÇÃO (Handler de cada instrução)
+// ============================================================
+// A decodificação (opcode -> funct3 -> funct7) é feita uma única vez e
+// reduzida a um destes valores; o 'execute' faz um único switch sobre ele.
+enum OpId : uint8_t {
+    OP_UNDECODED = 0, // Entrada vazia da cache (ainda não decodificada)
+
+    // TIPO I - Operações imediatas
+    OP_ADDI, OP_SLTI, OP_SLTIU, OP_XORI, OP_ORI, OP_ANDI,
+    OP_SLLI, OP_SRLI, OP_SRAI,
+
+    // TIPO R - Operações entre registradores
+    OP_ADD, OP_SUB, OP_SLL, OP_SLT, OP_SLTU, OP_XOR,
+    OP_SRL, OP_SRA, OP_OR, OP_AND,
+
+    // RV32M - Multiplicação / divisão (TIPO R, funct7 = 0x01)
+    OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU,
+    OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+
+    // TIPO U
+    OP_LUI, OP_AUIPC,
+
+    // LOAD / STORE
+    OP_LB, OP_LH, OP_LW, OP_LBU, OP_LHU,
+    OP_SB, OP_SH, OP_SW,
+
+    // TIPO B / JAL / JALR
+    OP_BEQ, OP_BNE, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU,
+    OP_JAL, OP_JALR,
+
+    // FENCE / SISTEMA
+    OP_FENCE, OP_FENCE_I, OP_ECALL, OP_MRET, OP_WFI,
+    OP_CSRRW, OP_CSRRS, OP_CSRRC, OP_CSRRWI, OP_CSRRSI, OP_CSRRCI,
+
+    // RV32A - Atômicas (opcode 0x2F): LR/SC e AMOs de 32 bits
+    OP_LR_W, OP_SC_W,
+    OP_AMOSWAP_W, OP_AMOADD_W, OP_AMOXOR_W, OP_AMOAND_W, OP_AMOOR_W,
+    OP_AMOMIN_W, OP_AMOMAX_W, OP_AMOMINU_W, OP_AMOMAXU_W,
+
+    OP_NOP,     // Codificação válida sem efeito (ex.: CSR com funct3 = 4)
+    OP_ILLEGAL, // Opcode/funct3 desconhecido (a CPU para com erro)
+
+    OP_COUNT
+};
+
+/**
+ * @struct DecodedInstr
+ * @brief Forma compacta de uma instrução já decodificada.
+ *
+ * Instruções comprimidas (RV32C, 16 bits) são expandidas para a
+ * equivalente de 32 bits na decodificação, uma única vez. Os motores
+ * avançam o PC em 'len' bytes e calculam os alvos como (pc - 4) + imm
+ * com o PC já avançado: para manter essa conta, o imediato dos desvios
+ * e do JAL comprimidos já vem somado de 2.
+ */
+struct DecodedInstr {
+    uint8_t  op;   // OpId
+    uint8_t  rd;
+    uint8_t  rs1;  // Também é o 'uimm' dos CSRs imediatos
+    uint8_t  rs2;
+    uint8_t  len;  // Tamanho em bytes: 4, ou 2 (comprimida)
+    int32_t  imm;  // Imediato com extensão de sinal (ou endereço do CSR)
+    uint32_t raw;  // Palavra original (16 bits se comprimida; mensagens de erro)
+};
+
+// Decodifica 'instr'; se os 2 bits baixos não forem 11, só os 16 bits
+// baixos são usados (instrução comprimida)
+DecodedInstr decode_instr(uint32_t instr);
+// RV32C: equivalente de 32 bits de uma instrução de 16 bits (0 = ilegal)
+uint32_t expand_compressed(uint32_t half);
+const char* op_name(uint8_t op);
+
+/**
+ * @class DecodeCache
+ * @brief Cache de instruções decodificadas, indexada pelo PC.
+ *
+ * Cobre a MainRAM em páginas de 4 KB alocadas sob demanda, com uma
+ * entrada por meia-palavra (com RV32C uma instrução pode começar em
+ * qualquer endereço par). O Bus chama 'invalidate' em toda escrita na
+ * RAM, e o FENCE.I chama 'flush'.
+ *
+ * Compartilhamento ('share'): máquinas que carregaram a mesma imagem usam
+ * as páginas de uma cache de origem comum, decodificadas uma única vez. A
+ * primeira escrita da máquina numa página a torna própria (cópia da
+ * página compartilhada, se houver), e uma página escrita nunca volta a
+ * ser compartilhada: as páginas compartilhadas só contêm a imagem
+ * original. 'flush'/'invalidate_page' encerram o compartilhamento.
+ * Não é thread-safe: a origem só pode ser usada por uma thread.
+ */
+class DecodeCache {
+public:
+    static const uint32_t PAGE_SHIFT = 12;
+    static const uint32_t PAGE_BYTES = 1u << PAGE_SHIFT;
+    static const uint32_t PAGE_ENTRIES = PAGE_BYTES / 2; // Uma por meia-palavra
+
+    uint64_t hits;
+    uint64_t misses;
+
+    DecodeCache();
+
+    // Ajusta a cobertura ao tamanho da RAM (descarta tudo se mudar)
+    void resize(uint32_t ram_size);
+
+    /**
+     * @brief Retorna a entrada do PC (criando a página se preciso), ou
+     * nullptr se o PC estiver fora da RAM (não cacheável).
+     */
+    DecodedInstr* lookup(uint32_t pc) {
+        uint32_t local = pc - MAIN_RAM_START;
+        if (local >= ram_size || (local & 1)) return nullptr;
+        DecodedInstr* page = pages[local >> PAGE_SHIFT];
+        if (!page) page = attach(local >> PAGE_SHIFT);
+        return &page[(local >> 1) & (PAGE_ENTRIES - 1)];
+    }
+
+    /**
+     * @brief Chamado pelo Bus em cada escrita na RAM (código
+     * auto-modificável). Descarta as instruções que podem conter a
+     * palavra de 'addr': as que começam nas suas duas metades e a de 32
+     * bits que começa 2 bytes antes dela.
+     */
+    void invalidate(uint32_t addr) {
+        uint32_t local = (addr & ~3u) - MAIN_RAM_START;
+        if (local >= ram_size) return;
+        uint32_t index = local >> PAGE_SHIFT;
+        uint32_t slot = (local >> 1) & (PAGE_ENTRIES - 1);
+        DecodedInstr* page = pages[index];
+        if (origin && (!page || page != owned[index].get()))
+            page = claim(index);
+        if (page) {
+            page[slot].op = OP_UNDECODED;
+            page[slot + 1].op = OP_UNDECODED;
+            if (slot) page[slot - 1].op = OP_UNDECODED;
+        }
+        if (!slot && index) invalidate_last(index - 1); // Fim da página anterior
+    }
+
+    void flush(); // FENCE.I: descarta todas as páginas
+    void invalidate_page(uint32_t addr); // Descarta a página de 4 KB de 'addr'
+
+    // Passa a usar as páginas de 'source' (mesma imagem, mesmo tamanho de RAM)
+    void share(DecodeCache* source);
+    bool shared() const { return origin != nullptr; }
+
+private:
+    uint32_t ram_size; // Bytes cobertos a partir de MAIN_RAM_START
+    std::vector<DecodedInstr*> pages;                   // Página em uso: própria ou da origem
+    std::vector<std::unique_ptr<DecodedInstr[]>> owned; // Páginas próprias
+    DecodeCache* origin; // Cache compartilhada (nullptr = nenhuma)
+
+    DecodedInstr* attach(uint32_t index); // Página ausente: da origem ou nova
+    DecodedInstr* claim(uint32_t index);  // Página escrita: passa a ser própria
+    void invalidate_last(uint32_t index); // Última entrada da página 'index'
+    void detach();
+};
+
+#endif // ICACHE_H
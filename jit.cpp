@@ -0,0 +1,485 @@
+#include "jit.h"
+#include "bus.h"
+#include "cpu.h"
+#include "rv32m.h"
+#include <cstring>
+#include <vector>
+
+#if RISCV_JIT_AVAILABLE
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+// ============================================================
+//  FUNÇÕES AUXILIARES (Chamadas pelo código nativo)
+// ============================================================
+// LOAD/STORE passam pelo Bus exatamente como no 'execute', então MMIO
+// (tohost), limites da RAM e invalidação de código continuam valendo.
+static uint32_t jit_load(JitContext* ctx, uint32_t addr, uint32_t op)
+{
+    Bus& bus = *ctx->bus;
+    ctx->events[HPM_EVENT_LOAD]++;
+    switch (op)
+    {
+    case OP_LB:  return (int32_t)(int8_t)bus.readByte(addr);
+    case OP_LH:  return (int32_t)(int16_t)bus.readHalf(addr);
+    case OP_LW:  return bus.readWord(addr);
+    case OP_LBU: return bus.readByte(addr);
+    case OP_LHU: return bus.readHalf(addr);
+    default:     return 0;
+    }
+}
+
+// Retorna != 0 se o bloco deve parar (escrita em MMIO, que pede um ponto
+// de serviço da CPU, ou código alterado)
+static uint32_t jit_store(JitContext* ctx, uint32_t addr, uint32_t value, uint32_t op)
+{
+    Bus& bus = *ctx->bus;
+    ctx->events[HPM_EVENT_STORE]++;
+    switch (op)
+    {
+    case OP_SB: bus.writeByte(addr, value & 0xFF); break;
+    case OP_SH: bus.writeHalf(addr, value & 0xFFFF); break;
+    case OP_SW: bus.writeWord(addr, value); break;
+    }
+    return bus.serviceRequested() || ctx->blocks->epoch != ctx->epoch;
+}
+
+// DIV/DIVU/REM/REMU: os casos de divisão por zero e estouro ficam em C++
+// (o 'idiv' do x86 geraria exceção no host)
+static uint32_t jit_div(uint32_t a, uint32_t b, uint32_t op)
+{
+    switch (op)
+    {
+    case OP_DIV:  return rv_div(a, b);
+    case OP_DIVU: return rv_divu(a, b);
+    case OP_REM:  return rv_rem(a, b);
+    case OP_REMU: return rv_remu(a, b);
+    default:      return 0;
+    }
+}
+
+#if RISCV_JIT_AVAILABLE
+
+// ============================================================
+//  EMISSOR x86-64 (Somente as formas usadas pelo JIT)
+// ============================================================
+namespace {
+
+enum X86Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+              R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13 };
+
+enum X86Cond { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD };
+
+// Registradores de argumento da convenção de chamada do host
+#ifdef _WIN32
+const X86Reg ARG0 = RCX, ARG1 = RDX, ARG2 = R8, ARG3 = R9;
+#else
+const X86Reg ARG0 = RDI, ARG1 = RSI, ARG2 = RDX, ARG3 = RCX;
+#endif
+
+const X86Reg REGS = RBX; // uint32_t* regs
+const X86Reg CTX  = R12; // JitContext*
+const X86Reg DONE = R13; // Instruções concluídas nas iterações anteriores do laço
+
+class X86Emitter {
+public:
+    std::vector<uint8_t> code;
+
+    void u8(uint8_t v)  { code.push_back(v); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) u8((v >> (8 * i)) & 0xFF); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) u8((v >> (8 * i)) & 0xFF); }
+
+    void rex(bool w, int reg, int rm) {
+        uint8_t r = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+        if (r != 0x40) u8(r);
+    }
+
+    // opcode reg, [base + disp32]
+    void op_mem(uint8_t opcode, int reg, int base, int32_t disp, bool w = false) {
+        rex(w, reg, base);
+        u8(opcode);
+        u8(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == RSP) u8(0x24); // SIB para RSP/R12
+        u32(disp);
+    }
+
+    // opcode reg, rm (registrador-registrador)
+    void op_rr(uint8_t opcode, int reg, int rm, bool w = false) {
+        rex(w, reg, rm);
+        u8(opcode);
+        u8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void load_reg(int dst, uint32_t rv)   { op_mem(0x8B, dst, REGS, rv * 4); }  // mov dst, regs[rv]
+    void store_reg(uint32_t rv, int src)  { op_mem(0x89, src, REGS, rv * 4); }  // mov regs[rv], src
+    void mov_imm32(int dst, uint32_t imm) { rex(false, 0, dst); u8(0xB8 + (dst & 7)); u32(imm); }
+    void mov_imm64(int dst, uint64_t imm) { rex(true, 0, dst); u8(0xB8 + (dst & 7)); u64(imm); }
+    void mov_mem_imm32(int base, int32_t disp, uint32_t imm) { op_mem(0xC7, 0, base, disp); u32(imm); }
+
+    void alu_mem_imm(int ext, int base, int32_t disp, uint32_t imm) { op_mem(0x81, ext, base, disp); u32(imm); }
+    void alu_imm(int ext, int dst, uint32_t imm) { rex(false, 0, dst); u8(0x81); u8(0xC0 | (ext << 3) | (dst & 7)); u32(imm); }
+    void shift_imm(int ext, int dst, uint8_t n)  { rex(false, 0, dst); u8(0xC1); u8(0xC0 | (ext << 3) | (dst & 7)); u8(n); }
+    void shift_cl(int ext, int dst)              { rex(false, 0, dst); u8(0xD3); u8(0xC0 | (ext << 3) | (dst & 7)); }
+    void shift_imm64(int ext, int dst, uint8_t n) { rex(true, 0, dst); u8(0xC1); u8(0xC0 | (ext << 3) | (dst & 7)); u8(n); }
+
+    // imul dst, src (32 ou 64 bits)
+    void imul_rr(int dst, int src, bool w = false) { rex(w, dst, src); u8(0x0F); u8(0xAF); u8(0xC0 | ((dst & 7) << 3) | (src & 7)); }
+    // movsxd dst, regs[rv] (extensão de sinal para 64 bits)
+    void load_reg_sx64(int dst, uint32_t rv) { op_mem(0x63, dst, REGS, rv * 4, true); }
+
+    // eax = (flags satisfazem cc) ? 1 : 0
+    void setcc_eax(int cc) { u8(0x0F); u8(0x90 | cc); u8(0xC0); u8(0x0F); u8(0xB6); u8(0xC0); }
+    // cmovcc dst, src
+    void cmov(int cc, int dst, int src) { rex(false, dst, src); u8(0x0F); u8(0x40 | cc); u8(0xC0 | ((dst & 7) << 3) | (src & 7)); }
+
+    void call_abs(const void* fn) { mov_imm64(RAX, (uint64_t)(uintptr_t)fn); u8(0xFF); u8(0xD0); }
+
+    // jmp rel32 para trás (destino já emitido)
+    void jmp_back32(size_t target) { u8(0xE9); u32((uint32_t)(target - (code.size() + 4))); }
+
+    // Salto rel32 cujo destino é corrigido depois; retorna a posição do campo
+    size_t jmp_rel32() { u8(0xE9); u32(0); return code.size() - 4; }
+    void patch_rel32(size_t at, size_t target) {
+        uint32_t rel = (uint32_t)(target - (at + 4));
+        std::memcpy(&code[at], &rel, 4);
+    }
+};
+
+// Operações de ULA: extensão do grupo 0x81 (imm) e opcode r/m,r (reg)
+struct AluForm { int ext; uint8_t rr; };
+const AluForm ALU_ADD = { 0, 0x01 }, ALU_OR = { 1, 0x09 }, ALU_AND = { 4, 0x21 },
+              ALU_SUB = { 5, 0x29 }, ALU_XOR = { 6, 0x31 }, ALU_CMP = { 7, 0x39 };
+const int SH_SHL = 4, SH_SHR = 5, SH_SAR = 7;
+
+} // namespace
+
+#endif // RISCV_JIT_AVAILABLE
+
+// ============================================================
+//  JIT COMPILER
+// ============================================================
+JitCompiler::JitCompiler()
+    : compiled(0), rejected(0), flushes(0), buffer(nullptr), used(0), out_of_space(false)
+{
+}
+
+JitCompiler::~JitCompiler()
+{
+#if RISCV_JIT_AVAILABLE
+    if (buffer) {
+#ifdef _WIN32
+        VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+        munmap(buffer, BUFFER_SIZE);
+#endif
+    }
+#endif
+}
+
+void JitCompiler::flush()
+{
+    if (used) flushes++;
+    used = 0;
+    out_of_space = false;
+}
+
+void JitCompiler::reset()
+{
+    flush();
+    compiled = 0;
+    rejected = 0;
+    flushes = 0;
+}
+
+#if RISCV_JIT_AVAILABLE
+// W^X: as páginas de [code, code + size) ficam graváveis ou executáveis,
+// nunca as duas coisas
+static bool protect_code(uint8_t* code, size_t size, bool executable)
+{
+    const uintptr_t PAGE = 4096;
+    uintptr_t start = (uintptr_t)code & ~(PAGE - 1);
+    size_t length = (((uintptr_t)code + size + PAGE - 1) & ~(PAGE - 1)) - start;
+#ifdef _WIN32
+    DWORD old;
+    return VirtualProtect((void*)start, length, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &old) != 0;
+#else
+    return mprotect((void*)start, length, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+#endif
+
+JitFn JitCompiler::compile(const BasicBlock& block)
+{
+#if RISCV_JIT_AVAILABLE
+    out_of_space = false;
+
+    // 1. Só compila blocos cujas instruções são todas suportadas
+    //    (no OpId, tudo a partir de OP_FENCE é SISTEMA/FENCE/atômica/erro)
+    for (const DecodedInstr& d : block.instrs) {
+        if (d.op == OP_UNDECODED || d.op >= OP_FENCE) {
+            rejected++;
+            return nullptr;
+        }
+    }
+    // Os desvios tomados são contados pelo PC de saída (ver run_blocks):
+    // um desvio final para o próprio fall-through fica interpretado
+    const DecodedInstr& last = block.instrs.back();
+    if (last.op >= OP_BEQ && last.op <= OP_BGEU && block.end_pc - 4 + (uint32_t)last.imm == block.end_pc) {
+        rejected++;
+        return nullptr;
+    }
+
+    X86Emitter e;
+    std::vector<size_t> exits; // Saltos para o epílogo
+    const int32_t RETIRED = (int32_t)offsetof(JitContext, retired);
+    const int32_t BUDGET = (int32_t)offsetof(JitContext, budget);
+
+    // 2. Prólogo: salva RBX/R12/R13 e reserva 32 bytes (shadow space Win64)
+    e.u8(0x53);                     // push rbx
+    e.u8(0x41); e.u8(0x54);         // push r12
+    e.u8(0x41); e.u8(0x55);         // push r13
+    e.u8(0x48); e.u8(0x83); e.u8(0xEC); e.u8(0x20); // sub rsp, 32
+    e.op_rr(0x89, ARG0, REGS, true); // mov rbx, regs
+    e.op_rr(0x89, ARG1, CTX, true);  // mov r12, ctx
+    e.op_rr(0x31, DONE, DONE);       // xor r13d, r13d
+    size_t body = e.code.size();      // Início do corpo (alvo do laço)
+
+    uint32_t pc = block.start_pc;
+    size_t n = block.instrs.size();
+    bool terminated = false;
+
+    for (size_t i = 0; i < n; pc += block.instrs[i].len, ++i) {
+        const DecodedInstr& d = block.instrs[i];
+        const uint32_t rd = d.rd, rs1 = d.rs1, rs2 = d.rs2;
+        const uint32_t imm = (uint32_t)d.imm;
+        // PC seguinte e base dos alvos relativos: como no 'execute',
+        // alvo = (PC seguinte - 4) + imm (ver DecodedInstr::len)
+        const uint32_t next = pc + d.len;
+        const uint32_t base = next - 4;
+
+        switch (d.op)
+        {
+        // --- TIPO I ---
+        case OP_ADDI: case OP_XORI: case OP_ORI: case OP_ANDI:
+        case OP_SLLI: case OP_SRLI: case OP_SRAI:
+        case OP_SLTI: case OP_SLTIU:
+            if (rd == 0) break;
+            e.load_reg(RAX, rs1);
+            switch (d.op)
+            {
+            case OP_ADDI:  e.alu_imm(ALU_ADD.ext, RAX, imm); break;
+            case OP_XORI:  e.alu_imm(ALU_XOR.ext, RAX, imm); break;
+            case OP_ORI:   e.alu_imm(ALU_OR.ext, RAX, imm); break;
+            case OP_ANDI:  e.alu_imm(ALU_AND.ext, RAX, imm); break;
+            case OP_SLLI:  e.shift_imm(SH_SHL, RAX, imm); break;
+            case OP_SRLI:  e.shift_imm(SH_SHR, RAX, imm); break;
+            case OP_SRAI:  e.shift_imm(SH_SAR, RAX, imm); break;
+            case OP_SLTI:  e.alu_imm(ALU_CMP.ext, RAX, imm); e.setcc_eax(CC_L); break;
+            case OP_SLTIU: e.alu_imm(ALU_CMP.ext, RAX, imm); e.setcc_eax(CC_B); break;
+            }
+            e.store_reg(rd, RAX);
+            break;
+
+        // --- TIPO R ---
+        case OP_ADD: case OP_SUB: case OP_XOR: case OP_OR: case OP_AND:
+        case OP_SLL: case OP_SRL: case OP_SRA: case OP_SLT: case OP_SLTU:
+            if (rd == 0) break;
+            e.load_reg(RAX, rs1);
+            e.load_reg(RCX, rs2);
+            switch (d.op)
+            {
+            case OP_ADD:  e.op_rr(ALU_ADD.rr, RCX, RAX); break;
+            case OP_SUB:  e.op_rr(ALU_SUB.rr, RCX, RAX); break;
+            case OP_XOR:  e.op_rr(ALU_XOR.rr, RCX, RAX); break;
+            case OP_OR:   e.op_rr(ALU_OR.rr, RCX, RAX); break;
+            case OP_AND:  e.op_rr(ALU_AND.rr, RCX, RAX); break;
+            case OP_SLL:  e.shift_cl(SH_SHL, RAX); break; // x86 já mascara CL em 5 bits
+            case OP_SRL:  e.shift_cl(SH_SHR, RAX); break;
+            case OP_SRA:  e.shift_cl(SH_SAR, RAX); break;
+            case OP_SLT:  e.op_rr(ALU_CMP.rr, RCX, RAX); e.setcc_eax(CC_L); break;
+            case OP_SLTU: e.op_rr(ALU_CMP.rr, RCX, RAX); e.setcc_eax(CC_B); break;
+            }
+            e.store_reg(rd, RAX);
+            break;
+
+        // --- RV32M: multiplicações nativas (a parte alta sai de um imul de 64 bits) ---
+        case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU:
+            if (rd == 0) break;
+            switch (d.op)
+            {
+            case OP_MUL:    e.load_reg(RAX, rs1); e.load_reg(RCX, rs2); e.imul_rr(RAX, RCX); break;
+            case OP_MULH:   e.load_reg_sx64(RAX, rs1); e.load_reg_sx64(RCX, rs2); break;
+            case OP_MULHSU: e.load_reg_sx64(RAX, rs1); e.load_reg(RCX, rs2); break;
+            case OP_MULHU:  e.load_reg(RAX, rs1); e.load_reg(RCX, rs2); break; // mov zera os 32 bits altos
+            }
+            if (d.op != OP_MUL) {
+                e.imul_rr(RAX, RCX, true);
+                e.shift_imm64(SH_SHR, RAX, 32);
+            }
+            e.store_reg(rd, RAX);
+            break;
+
+        // --- RV32M: divisões, jit_div(regs[rs1], regs[rs2], op) ---
+        case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+            if (rd == 0) break;
+            e.load_reg(ARG0, rs1);
+            e.load_reg(ARG1, rs2);
+            e.mov_imm32(ARG2, d.op);
+            e.call_abs((const void*)&jit_div);
+            e.store_reg(rd, RAX);
+            break;
+
+        // --- TIPO U ---
+        case OP_LUI:
+            if (rd) e.mov_mem_imm32(REGS, rd * 4, imm);
+            break;
+        case OP_AUIPC:
+            if (rd) e.mov_mem_imm32(REGS, rd * 4, base + imm);
+            break;
+
+        // --- LOAD: jit_load(ctx, regs[rs1] + imm, op) ---
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU:
+            if (rd == 0) break; // Como no 'execute': não acessa o barramento
+            e.op_rr(0x89, CTX, ARG0, true);
+            e.load_reg(ARG1, rs1);
+            e.alu_imm(ALU_ADD.ext, ARG1, imm);
+            e.mov_imm32(ARG2, d.op);
+            e.call_abs((const void*)&jit_load);
+            e.store_reg(rd, RAX);
+            break;
+
+        // --- STORE: jit_store(ctx, regs[rs1] + imm, regs[rs2], op) ---
+        case OP_SB: case OP_SH: case OP_SW:
+        {
+            e.op_rr(0x89, CTX, ARG0, true);
+            e.load_reg(ARG1, rs1);
+            e.alu_imm(ALU_ADD.ext, ARG1, imm);
+            e.load_reg(ARG2, rs2);
+            e.mov_imm32(ARG3, d.op);
+            e.call_abs((const void*)&jit_store);
+            // test eax, eax / jz continua
+            e.u8(0x85); e.u8(0xC0);
+            e.u8(0x74); size_t skip = e.code.size(); e.u8(0);
+            // Saída antecipada: tohost escrito ou código alterado
+            e.mov_imm32(RAX, next);
+            e.op_mem(0x89, DONE, CTX, RETIRED);              // retired = r13d
+            e.alu_mem_imm(ALU_ADD.ext, CTX, RETIRED, (uint32_t)(i + 1));
+            exits.push_back(e.jmp_rel32());
+            e.code[skip] = (uint8_t)(e.code.size() - (skip + 1));
+            break;
+        }
+
+        // --- TIPO B: eax = condição ? alvo : fall-through ---
+        case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+        {
+            int cc = CC_E;
+            switch (d.op)
+            {
+            case OP_BEQ:  cc = CC_E; break;
+            case OP_BNE:  cc = CC_NE; break;
+            case OP_BLT:  cc = CC_L; break;
+            case OP_BGE:  cc = CC_GE; break;
+            case OP_BLTU: cc = CC_B; break;
+            case OP_BGEU: cc = CC_AE; break;
+            }
+            e.load_reg(RAX, rs1);
+            e.op_mem(0x3B, RAX, REGS, rs2 * 4); // cmp eax, regs[rs2]
+            e.mov_imm32(RAX, next);              // mov não altera as flags
+            e.mov_imm32(RCX, base + imm);
+            e.cmov(cc, RAX, RCX);
+            terminated = true;
+            break;
+        }
+
+        // --- JAL / JALR ---
+        case OP_JAL:
+            if (rd) e.mov_mem_imm32(REGS, rd * 4, next);
+            e.mov_imm32(RAX, base + imm);
+            terminated = true;
+            break;
+        case OP_JALR:
+            e.load_reg(RAX, rs1);
+            e.alu_imm(ALU_ADD.ext, RAX, imm);
+            e.alu_imm(ALU_AND.ext, RAX, ~1u);
+            if (rd) e.mov_mem_imm32(REGS, rd * 4, next);
+            terminated = true;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // 3. Fim do bloco: PC seguinte em EAX (se o bloco não terminou em desvio)
+    if (!terminated) e.mov_imm32(RAX, block.end_pc);
+    e.alu_imm(ALU_ADD.ext, DONE, (uint32_t)n);
+
+    // Laço: se o alvo é o próprio bloco e cabe mais uma iteração, repete
+    if (terminated) {
+        e.alu_imm(ALU_CMP.ext, RAX, block.start_pc);
+        size_t not_loop = e.code.size() + 1;
+        e.u8(0x75); e.u8(0);                             // jne fim
+        e.op_rr(0x8B, RCX, DONE);                        // mov ecx, r13d
+        e.alu_imm(ALU_ADD.ext, RCX, (uint32_t)n);
+        e.op_mem(0x3B, RCX, CTX, BUDGET);                // cmp ecx, budget
+        size_t over = e.code.size() + 1;
+        e.u8(0x77); e.u8(0);                             // ja fim
+        e.jmp_back32(body);
+        e.code[not_loop] = (uint8_t)(e.code.size() - (not_loop + 1));
+        e.code[over] = (uint8_t)(e.code.size() - (over + 1));
+    }
+    e.op_mem(0x89, DONE, CTX, RETIRED);                  // retired = r13d
+
+    // 4. Epílogo (destino de todas as saídas)
+    size_t epilogue = e.code.size();
+    for (size_t at : exits) e.patch_rel32(at, epilogue);
+    e.u8(0x48); e.u8(0x83); e.u8(0xC4); e.u8(0x20); // add rsp, 32
+    e.u8(0x41); e.u8(0x5D);         // pop r13
+    e.u8(0x41); e.u8(0x5C);         // pop r12
+    e.u8(0x5B);                     // pop rbx
+    e.u8(0xC3);                     // ret
+
+    // 5. Copia para o buffer: as páginas do bloco (que podem ter código de
+    //    blocos anteriores) só ficam graváveis durante a cópia
+    if (!buffer) {
+#ifdef _WIN32
+        void* mem = VirtualAlloc(nullptr, BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+        void* mem = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) mem = nullptr;
+#endif
+        if (!mem) {
+            rejected++;
+            return nullptr;
+        }
+        buffer = static_cast<uint8_t*>(mem);
+    }
+    if (used + e.code.size() > BUFFER_SIZE) {
+        out_of_space = true; // A CPU descarta o buffer ('flush') e tenta de novo
+        return nullptr;
+    }
+
+    uint8_t* fn = buffer + used;
+    if (!protect_code(fn, e.code.size(), false)) {
+        rejected++;
+        return nullptr;
+    }
+    std::memcpy(fn, e.code.data(), e.code.size());
+    if (!protect_code(fn, e.code.size(), true)) {
+        rejected++;
+        return nullptr;
+    }
+    used += (e.code.size() + 15) & ~(size_t)15;
+    compiled++;
+    return reinterpret_cast<JitFn>(fn);
+#else
+    (void)block;
+    rejected++;
+    return nullptr;
+#endif
+}
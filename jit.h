@@ -0,0 +1,75 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "block.h"
+
+class Bus;
+
+// O JIT só existe em hosts x86-64 (e pode ser removido com -DRISCV_NO_JIT)
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(RISCV_NO_JIT)
+#define RISCV_JIT_AVAILABLE 1
+#else
+#define RISCV_JIT_AVAILABLE 0
+#endif
+
+/**
+ * @struct JitContext
+ * @brief Estado compartilhado entre o código nativo e a CPU.
+ * O código gerado recebe 'regs' (fixo em RBX) e este contexto (em R12).
+ */
+struct JitContext {
+    Bus* bus;
+    const BlockCache* blocks;
+    uint64_t epoch;    // Época da BlockCache na entrada do bloco
+    uint32_t budget;   // Máximo de instruções que o código nativo pode executar
+    uint32_t retired;  // Instruções concluídas (escrito pelo código nativo)
+    uint64_t* events;  // CPU::hpm_events (LOAD/STORE contados pelas funções auxiliares)
+};
+
+/**
+ * @class JitCompiler
+ * @brief Gera código x86-64 para blocos básicos "quentes".
+ *
+ * Suporta ULA, LUI/AUIPC, desvios, JAL/JALR e LOAD/STORE (estes via
+ * chamadas ao Bus, o que cobre MMIO). Blocos com SISTEMA/CSR/FENCE não
+ * são compilados e continuam no interpretador. Um bloco que desvia para
+ * o próprio início (laço) repete dentro do código nativo enquanto houver
+ * 'budget'.
+ */
+class JitCompiler {
+public:
+    static const size_t BUFFER_SIZE = 8 * 1024 * 1024;
+
+    uint64_t compiled; // Blocos compilados
+    uint64_t rejected; // Blocos com instruções não suportadas
+    uint64_t flushes;  // Vezes em que o buffer encheu e foi descartado
+
+    JitCompiler();
+    ~JitCompiler();
+
+    /**
+     * @brief Compila o bloco. Retorna nullptr se o bloco tiver instrução
+     * não suportada, se o buffer estiver cheio ('full') ou se não houver JIT.
+     */
+    JitFn compile(const BasicBlock& block);
+
+    // O último 'compile' falhou por falta de espaço no buffer
+    bool full() const { return out_of_space; }
+
+    // Descarta todo o código gerado (nenhum bloco pode mais apontar para
+    // ele); 'reset' zera também as estatísticas
+    void flush();
+    void reset();
+
+private:
+    uint8_t* buffer; // Código gerado (alocado no primeiro uso; W^X, ver 'compile')
+    size_t used;
+    bool out_of_space;
+
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+};
+
+#endif // JIT_H
@@ -0,0 +1,601 @@
+#include "loader.h"
+#include "bus.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RISCV_HAVE_MMAP 1
+#endif
+
+namespace fs = std::filesystem;
+
+// ============================================================
+//  ARQUIVO MAPEADO EM MEMÓRIA (Somente leitura)
+// ============================================================
+// Sem mmap/MapViewOfFile, o arquivo é lido inteiro para um buffer.
+namespace {
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename)
+        : ptr(nullptr), length(0), mapped(false), opened(false) {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file != INVALID_HANDLE_VALUE) {
+            LARGE_INTEGER size;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+                HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping) {
+                    ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                    CloseHandle(mapping);
+                    if (ptr) { length = (size_t)size.QuadPart; mapped = true; }
+                }
+            }
+            CloseHandle(file);
+            if (mapped) return;
+        }
+#elif defined(RISCV_HAVE_MMAP)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    ptr = static_cast<const uint8_t*>(p);
+                    length = (size_t)st.st_size;
+                    mapped = true;
+                }
+            }
+            close(fd);
+            if (mapped) return;
+        }
+#endif
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) return;
+        fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        ptr = reinterpret_cast<const uint8_t*>(fallback.data());
+        length = fallback.size();
+        opened = true;
+    }
+
+    ~MappedFile() {
+        if (!mapped) return;
+#if defined(_WIN32)
+        UnmapViewOfFile(ptr);
+#elif defined(RISCV_HAVE_MMAP)
+        munmap(const_cast<uint8_t*>(ptr), length);
+#endif
+    }
+
+    bool ok() const { return mapped || opened; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* ptr;
+    size_t length;
+    bool mapped; // true: mmap/MapViewOfFile; false: cópia em 'fallback'
+    bool opened;
+    std::vector<char> fallback;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+// Campos do ELF em little-endian (o arquivo não tem alinhamento garantido)
+uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t rd32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Constantes do formato ELF32 usadas aqui
+const uint8_t  ELFCLASS32  = 1;
+const uint8_t  ELFDATA2LSB = 1;
+const uint16_t EM_RISCV    = 243;
+const uint32_t PT_LOAD     = 1;
+const uint32_t SHT_SYMTAB  = 2;
+const uint32_t SHF_EXECINSTR = 0x4;
+const uint8_t  STT_NOTYPE  = 0;
+const uint8_t  STT_FUNC    = 2;
+const uint16_t SHN_LORESERVE = 0xFF00;
+const size_t   EHDR_SIZE   = 52;
+const size_t   PHDR_SIZE   = 32;
+const size_t   SHDR_SIZE   = 40;
+const size_t   SYM_SIZE    = 16;
+
+bool elf_error(const std::string& filename, const char* what)
+{
+    log_err() << "[Loader] ERRO: " << fs::path(filename).filename().string() << ": " << what << "\n";
+    return false;
+}
+
+/**
+ * @struct SymbolTable
+ * @brief A primeira tabela de símbolos (SHT_SYMTAB) do arquivo e a
+ * tabela de strings associada, já validadas contra o tamanho do arquivo.
+ */
+struct SymbolTable {
+    const uint8_t* shdrs = nullptr; // Section headers (para o st_shndx dos símbolos)
+    uint16_t shentsize = 0, shnum = 0;
+    const uint8_t* syms = nullptr;
+    uint32_t sym_size = 0;
+    const char* strs = nullptr;
+    uint32_t str_size = 0;
+};
+
+bool find_symtab(const uint8_t* file, size_t size, SymbolTable& tab)
+{
+    uint32_t shoff = rd32(file + 32);
+    uint16_t shentsize = rd16(file + 46);
+    uint16_t shnum = rd16(file + 48);
+    if (shoff == 0 || shentsize < SHDR_SIZE || shoff + (uint64_t)shnum * shentsize > size) return false;
+
+    for (uint16_t i = 0; i < shnum; ++i) {
+        const uint8_t* sh = file + shoff + (size_t)i * shentsize;
+        if (rd32(sh + 4) != SHT_SYMTAB) continue;
+
+        uint32_t sym_off = rd32(sh + 16), sym_size = rd32(sh + 20), link = rd32(sh + 24);
+        if (link >= shnum || sym_off + (uint64_t)sym_size > size) return false;
+        const uint8_t* str_sh = file + shoff + (size_t)link * shentsize;
+        uint32_t str_off = rd32(str_sh + 16), str_size = rd32(str_sh + 20);
+        if (str_off + (uint64_t)str_size > size) return false;
+
+        tab.shdrs = file + shoff;
+        tab.shentsize = shentsize;
+        tab.shnum = shnum;
+        tab.syms = file + sym_off;
+        tab.sym_size = sym_size;
+        tab.strs = reinterpret_cast<const char*>(file + str_off);
+        tab.str_size = str_size;
+        return true;
+    }
+    return false;
+}
+
+// Procura 'name' na primeira tabela de símbolos (SHT_SYMTAB) do arquivo
+bool find_symbol(const uint8_t* file, size_t size, const char* name, uint32_t& value)
+{
+    SymbolTable tab;
+    if (!find_symtab(file, size, tab)) return false;
+
+    size_t name_len = std::strlen(name);
+    for (uint32_t s = 0; s + SYM_SIZE <= tab.sym_size; s += SYM_SIZE) {
+        const uint8_t* sym = tab.syms + s;
+        uint32_t st_name = rd32(sym);
+        if (st_name + name_len + 1 > tab.str_size) continue;
+        if (std::memcmp(tab.strs + st_name, name, name_len + 1) == 0) {
+            value = rd32(sym + 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// ============================================================
+//  DETECÇÃO DO FORMATO
+// ============================================================
+ImageFormat detect_image_format(const std::string& filename)
+{
+    char magic[4] = { 0, 0, 0, 0 };
+    std::ifstream in(filename, std::ios::binary);
+    if (in.read(magic, 4) && std::memcmp(magic, "\x7F" "ELF", 4) == 0)
+        return IMAGE_ELF;
+
+    std::string ext = fs::path(filename).extension().string();
+    if (ext == ".hex") return IMAGE_HEX;
+    if (ext == ".bin") return IMAGE_BIN;
+    if (ext == ".elf") return IMAGE_ELF; // Assinatura inválida: load_elf reporta
+    return IMAGE_UNKNOWN;
+}
+
+// ============================================================
+//  ELF32
+// ============================================================
+bool load_elf(const std::string& filename, MainRAM& ram, ProgramImage& image)
+{
+    MappedFile file(filename);
+    if (!file.ok()) return elf_error(filename, "não foi possível abrir o arquivo");
+
+    const uint8_t* f = file.data();
+    size_t size = file.size();
+    if (size < EHDR_SIZE || std::memcmp(f, "\x7F" "ELF", 4) != 0)
+        return elf_error(filename, "assinatura ELF inválida");
+    if (f[4] != ELFCLASS32 || f[5] != ELFDATA2LSB)
+        return elf_error(filename, "somente ELF32 little-endian é suportado");
+    if (rd16(f + 18) != EM_RISCV)
+        return elf_error(filename, "e_machine não é RISC-V");
+
+    TRACE(TRACE_SUMMARY, "[Loader] Carregando " << fs::path(filename).filename().string() << " (ELF)...\n");
+
+    uint32_t phoff = rd32(f + 28);
+    uint16_t phentsize = rd16(f + 42);
+    uint16_t phnum = rd16(f + 44);
+    if (phentsize < PHDR_SIZE || phoff + (uint64_t)phnum * phentsize > size)
+        return elf_error(filename, "tabela de program headers fora do arquivo");
+
+    image.entry = rd32(f + 24);
+    image.has_tohost = false;
+    image.tohost = 0;
+    image.has_fromhost = false;
+    image.fromhost = 0;
+    image.bytes = 0;
+    image.from_cache = false;
+
+    uint8_t* ram_base = ram.data();
+    for (uint16_t i = 0; i < phnum; ++i) {
+        const uint8_t* ph = f + phoff + (size_t)i * phentsize;
+        if (rd32(ph) != PT_LOAD) continue;
+
+        uint32_t offset = rd32(ph + 4);
+        uint32_t paddr = rd32(ph + 12);
+        uint32_t filesz = rd32(ph + 16);
+        uint32_t memsz = rd32(ph + 20);
+        if (memsz == 0) continue;
+
+        uint32_t local = paddr - MAIN_RAM_START;
+        if (filesz > memsz || offset + (uint64_t)filesz > size ||
+            local >= ram.size() || memsz > ram.size() - local) {
+            log_err() << "[Loader] ERRO: Segmento 0x" << std::hex << paddr << " (+0x" << memsz
+                      << ") fora da RAM ou do arquivo" << std::dec << "\n";
+            return false;
+        }
+
+        // Cópia direta para a RAM; .bss (memsz > filesz) é zerado
+        std::memcpy(ram_base + local, f + offset, filesz);
+        std::memset(ram_base + local + filesz, 0, memsz - filesz);
+        ram.markDirtyRange(local, memsz);
+        image.bytes += memsz;
+        TRACE(TRACE_SUMMARY, "[Loader]   PT_LOAD 0x" << std::hex << paddr << " | " << std::dec
+                  << filesz << " bytes (+" << (memsz - filesz) << " zerados)\n");
+    }
+
+    image.has_tohost = find_symbol(f, size, "tohost", image.tohost);
+    image.has_fromhost = find_symbol(f, size, "fromhost", image.fromhost);
+    TRACE(TRACE_SUMMARY, "[Loader] Entrada: 0x" << std::hex << image.entry);
+    if (image.has_tohost) TRACE(TRACE_SUMMARY, " | tohost: 0x" << image.tohost);
+    if (image.has_fromhost) TRACE(TRACE_SUMMARY, " | fromhost: 0x" << image.fromhost);
+    TRACE(TRACE_SUMMARY, std::dec << "\n");
+    return true;
+}
+
+// ============================================================
+//  SÍMBOLOS DE CÓDIGO (perfilador)
+// ============================================================
+bool load_elf_symbols(const std::string& filename, std::vector<ImageSymbol>& symbols)
+{
+    symbols.clear();
+    MappedFile file(filename);
+    if (!file.ok()) return false;
+    const uint8_t* f = file.data();
+    size_t size = file.size();
+    if (size < EHDR_SIZE || std::memcmp(f, "\x7F" "ELF", 4) != 0 || f[4] != ELFCLASS32 || f[5] != ELFDATA2LSB)
+        return false;
+
+    SymbolTable tab;
+    if (!find_symtab(f, size, tab)) return false;
+
+    for (uint32_t s = 0; s + SYM_SIZE <= tab.sym_size; s += SYM_SIZE) {
+        const uint8_t* sym = tab.syms + s;
+        uint32_t st_name = rd32(sym);
+        uint8_t type = sym[12] & 0xF;
+        uint16_t shndx = rd16(sym + 14);
+        if (type != STT_FUNC && type != STT_NOTYPE) continue;
+        if (shndx == 0 || shndx >= SHN_LORESERVE || shndx >= tab.shnum) continue;
+        if (!(rd32(tab.shdrs + (size_t)shndx * tab.shentsize + 8) & SHF_EXECINSTR)) continue;
+        if (st_name == 0 || st_name >= tab.str_size) continue;
+
+        // Nome até o '\0' (limitado à tabela); '$x'/'$d' e '.L...' são do montador
+        const char* name = tab.strs + st_name;
+        size_t len = strnlen(name, tab.str_size - st_name);
+        if (len == 0 || name[0] == '$' || (len > 1 && name[0] == '.' && name[1] == 'L')) continue;
+        symbols.push_back({ rd32(sym + 4), rd32(sym + 8), std::string(name, len), type == STT_FUNC });
+    }
+
+    // Ordem de endereço; no mesmo endereço, o de tamanho conhecido primeiro
+    std::sort(symbols.begin(), symbols.end(), [](const ImageSymbol& a, const ImageSymbol& b) {
+        if (a.addr != b.addr) return a.addr < b.addr;
+        return a.size > b.size;
+    });
+    return true;
+}
+
+// ============================================================
+//  BINÁRIO CRU (.bin)
+// ============================================================
+bool load_binary(const std::string& filename, MainRAM& ram, uint32_t base, ProgramImage& image)
+{
+    MappedFile file(filename);
+    if (!file.ok()) return elf_error(filename, "não foi possível abrir o arquivo");
+
+    uint32_t local = base - MAIN_RAM_START;
+    if (local >= ram.size() || file.size() > ram.size() - local)
+        return elf_error(filename, "imagem maior que a RAM");
+
+    TRACE(TRACE_SUMMARY, "[Loader] Carregando " << fs::path(filename).filename().string()
+              << " (" << file.size() << " bytes)...\n");
+    if (file.size()) std::memcpy(ram.data() + local, file.data(), file.size());
+    ram.markDirtyRange(local, (uint32_t)file.size());
+
+    image.entry = base;
+    image.has_tohost = false;
+    image.tohost = 0;
+    image.has_fromhost = false;
+    image.fromhost = 0;
+    image.bytes = file.size();
+    image.from_cache = false;
+    return true;
+}
+
+// ============================================================
+//  HEX ("@endereço" + palavras)
+// ============================================================
+namespace {
+
+/**
+ * @struct HexChunk
+ * @brief Sequência de palavras em endereços consecutivos.
+ */
+struct HexChunk {
+    uint32_t addr;
+    std::vector<uint32_t> words;
+};
+
+int hex_digit(uint8_t c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool is_space(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Lê um número hexadecimal (com "0x" opcional) no início de [p, end).
+// Falha se não houver dígitos ou se não couber em 32 bits.
+bool parse_hex_u32(const uint8_t* p, const uint8_t* end, uint32_t& value)
+{
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && end - p > 2 && hex_digit(p[2]) >= 0)
+        p += 2;
+    uint64_t v = 0;
+    int digits = 0;
+    for (; p < end; ++p) {
+        int d = hex_digit(*p);
+        if (d < 0) break;
+        v = (v << 4) | (uint32_t)d;
+        if (v > 0xFFFFFFFFull) return false;
+        digits++;
+    }
+    if (digits == 0) return false;
+    value = (uint32_t)v;
+    return true;
+}
+
+/**
+ * @brief Parser manual do .hex: percorre o texto uma vez, sem streams e
+ * sem alocar nada por linha. Mesmas regras do parser antigo: linhas
+ * vazias e inválidas são ignoradas, "@XXXXXXXX" muda o endereço e, nas
+ * outras, só o primeiro número da linha é usado.
+ */
+void parse_hex_text(const uint8_t* p, const uint8_t* end, uint32_t base, std::vector<HexChunk>& chunks)
+{
+    uint32_t current_addr = base;
+    while (p < end) {
+        const uint8_t* line_end = static_cast<const uint8_t*>(std::memchr(p, '\n', end - p));
+        if (!line_end) line_end = end;
+
+        const uint8_t* q = p;
+        while (q < line_end && is_space(*q)) ++q;
+        p = line_end + (line_end < end ? 1 : 0);
+        if (q == line_end) continue;
+
+        uint32_t value;
+        if (*q == '@') {
+            if (parse_hex_u32(q + 1, line_end, value)) current_addr = value;
+            continue;
+        }
+        if (!parse_hex_u32(q, line_end, value)) continue;
+
+        if (chunks.empty() ||
+            chunks.back().addr + 4 * (uint32_t)chunks.back().words.size() != current_addr)
+            chunks.push_back(HexChunk{ current_addr, {} });
+        chunks.back().words.push_back(value);
+        current_addr += 4;
+    }
+}
+
+// ============================================================
+//  CACHE DE IMAGENS .hex JÁ ANALISADAS
+// ============================================================
+// Um arquivo por imagem, com nome derivado do caminho. O cabeçalho
+// repete a chave (caminho, tamanho, mtime, base) e só é aceito se tudo
+// bater. Os números ficam na ordem de bytes do host: a cache é local.
+//
+//   HexCacheHeader | caminho (múltiplo de 4) |
+//   [endereço, nº de palavras, palavras...] x chunk_count
+const char HEX_CACHE_MAGIC[4] = { 'R', 'V', 'H', 'C' };
+const uint32_t HEX_CACHE_VERSION = 1;
+
+struct HexCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint32_t base;
+    uint32_t chunk_count;
+    uint32_t path_length;
+    uint32_t reserved;
+};
+
+struct HexCacheKey {
+    std::string path; // Caminho absoluto da fonte
+    uint64_t size;
+    int64_t mtime;
+    std::string cache_file;
+};
+
+uint64_t fnv1a(const std::string& text)
+{
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : text) { h ^= c; h *= 1099511628211ull; }
+    return h;
+}
+
+bool make_cache_key(const std::string& filename, const std::string& cache_dir, uint32_t base, HexCacheKey& key)
+{
+    std::error_code ec;
+    fs::path abs = fs::absolute(filename, ec);
+    if (ec) return false;
+    key.path = abs.string();
+    key.size = fs::file_size(abs, ec);
+    if (ec) return false;
+    key.mtime = (int64_t)fs::last_write_time(abs, ec).time_since_epoch().count();
+    if (ec) return false;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.rvhc", (unsigned long long)(fnv1a(key.path) ^ base));
+    key.cache_file = (fs::path(cache_dir) / name).string();
+    return true;
+}
+
+size_t padded(size_t n) { return (n + 3) & ~(size_t)3; }
+
+// Lê a imagem da cache (um único mmap). false = ausente ou desatualizada.
+bool read_hex_cache(const HexCacheKey& key, uint32_t base, Bus& bus, ProgramImage& image)
+{
+    MappedFile file(key.cache_file);
+    if (!file.ok() || file.size() < sizeof(HexCacheHeader)) return false;
+
+    HexCacheHeader h;
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, HEX_CACHE_MAGIC, 4) != 0 || h.version != HEX_CACHE_VERSION ||
+        h.source_size != key.size || h.source_mtime != key.mtime || h.base != base ||
+        h.path_length != key.path.size())
+        return false;
+
+    const uint8_t* p = file.data() + sizeof(h);
+    const uint8_t* end = file.data() + file.size();
+    if ((size_t)(end - p) < padded(h.path_length) ||
+        std::memcmp(p, key.path.data(), h.path_length) != 0)
+        return false;
+    p += padded(h.path_length);
+
+    // Valida tudo antes de escrever qualquer coisa na RAM
+    const uint8_t* q = p;
+    for (uint32_t c = 0; c < h.chunk_count; ++c) {
+        uint32_t count;
+        if (end - q < 8) return false;
+        std::memcpy(&count, q + 4, 4);
+        if ((uint64_t)(end - q - 8) < (uint64_t)count * 4) return false;
+        q += 8 + (size_t)count * 4;
+    }
+
+    for (uint32_t c = 0; c < h.chunk_count; ++c) {
+        uint32_t addr, count;
+        std::memcpy(&addr, p, 4);
+        std::memcpy(&count, p + 4, 4);
+        p += 8;
+        for (uint32_t i = 0; i < count; ++i, p += 4) {
+            uint32_t word;
+            std::memcpy(&word, p, 4);
+            bus.writeWord(addr + 4 * i, word);
+        }
+        image.bytes += (uint64_t)count * 4;
+    }
+    return true;
+}
+
+// Grava a cache (arquivo temporário + rename: workers do '-j' podem
+// gravar a mesma imagem ao mesmo tempo). Erros só desligam a cache.
+void write_hex_cache(const HexCacheKey& key, uint32_t base, const std::vector<HexChunk>& chunks)
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(key.cache_file).parent_path(), ec);
+
+    HexCacheHeader h;
+    std::memcpy(h.magic, HEX_CACHE_MAGIC, 4);
+    h.version = HEX_CACHE_VERSION;
+    h.source_size = key.size;
+    h.source_mtime = key.mtime;
+    h.base = base;
+    h.chunk_count = (uint32_t)chunks.size();
+    h.path_length = (uint32_t)key.path.size();
+    h.reserved = 0;
+
+    std::string tmp = key.cache_file + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        static const char zeros[4] = { 0, 0, 0, 0 };
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(key.path.data(), key.path.size());
+        out.write(zeros, padded(key.path.size()) - key.path.size());
+        for (const HexChunk& chunk : chunks) {
+            uint32_t count = (uint32_t)chunk.words.size();
+            out.write(reinterpret_cast<const char*>(&chunk.addr), 4);
+            out.write(reinterpret_cast<const char*>(&count), 4);
+            out.write(reinterpret_cast<const char*>(chunk.words.data()), (std::streamsize)count * 4);
+        }
+        if (!out) { out.close(); fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, key.cache_file, ec);
+    if (ec) fs::remove(tmp, ec);
+}
+
+} // namespace
+
+bool load_hex(const std::string& filename, Bus& bus, uint32_t base_addr, ProgramImage& image,
+              const std::string& cache_dir)
+{
+    image.entry = base_addr;
+    image.has_tohost = false;
+    image.tohost = 0;
+    image.has_fromhost = false;
+    image.fromhost = 0;
+    image.bytes = 0;
+    image.from_cache = false;
+
+    HexCacheKey key;
+    bool use_cache = !cache_dir.empty() && make_cache_key(filename, cache_dir, base_addr, key);
+    if (use_cache && read_hex_cache(key, base_addr, bus, image)) {
+        image.from_cache = true;
+        TRACE(TRACE_SUMMARY, "[Loader] " << fs::path(filename).filename().string() << " carregado da cache.\n");
+        return true;
+    }
+
+    MappedFile file(filename);
+    if (!file.ok()) {
+        log_err() << "[Loader] ERRO: Não foi possível abrir " << filename << std::endl;
+        return false;
+    }
+
+    TRACE(TRACE_SUMMARY, "[Loader] Carregando " << fs::path(filename).filename().string() << "...\n");
+
+    std::vector<HexChunk> chunks;
+    parse_hex_text(file.data(), file.data() + file.size(), base_addr, chunks);
+    for (const HexChunk& chunk : chunks) {
+        for (size_t i = 0; i < chunk.words.size(); ++i)
+            bus.writeWord(chunk.addr + 4 * (uint32_t)i, chunk.words[i]);
+        image.bytes += chunk.words.size() * 4;
+    }
+    if (use_cache) write_hex_cache(key, base_addr, chunks);
+
+    TRACE(TRACE_SUMMARY, "[Loader] Carregamento concluído.\n");
+    return true;
+}
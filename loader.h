@@ -0,0 +1,73 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ram.h"
+
+class Bus;
+
+/**
+ * @struct ProgramImage
+ * @brief O que o carregador descobriu sobre a imagem carregada.
+ */
+struct ProgramImage {
+    uint32_t entry;     // PC inicial (ELF: e_entry; .hex/.bin: base da RAM)
+    bool has_tohost;    // O ELF tem o símbolo 'tohost'
+    uint32_t tohost;    // Endereço do símbolo 'tohost'
+    bool has_fromhost;  // Idem para o 'fromhost' (respostas do HTIF)
+    uint32_t fromhost;
+    uint64_t bytes;     // Bytes copiados para a RAM
+    bool from_cache;    // .hex lido da cache de imagens analisadas
+};
+
+/**
+ * @struct ImageSymbol
+ * @brief Símbolo de código do ELF (função ou rótulo), usado pelo perfilador.
+ */
+struct ImageSymbol {
+    uint32_t addr;
+    uint32_t size; // 0 = desconhecido (rótulos de assembly)
+    std::string name;
+    bool function; // STT_FUNC (os demais são rótulos)
+};
+
+enum ImageFormat { IMAGE_HEX, IMAGE_ELF, IMAGE_BIN, IMAGE_UNKNOWN };
+
+/**
+ * @brief Descobre o formato pelo conteúdo (assinatura ELF) e, se não for
+ * ELF, pela extensão (.hex / .bin).
+ */
+ImageFormat detect_image_format(const std::string& filename);
+
+/**
+ * @brief Carrega um ELF32 RISC-V little-endian: cada segmento PT_LOAD é
+ * copiado de uma vez (do arquivo mapeado em memória) direto para a
+ * MainRAM, com o resto até p_memsz zerado. Preenche 'entry' e, se
+ * houver tabela de símbolos, os endereços de 'tohost' e 'fromhost'.
+ */
+bool load_elf(const std::string& filename, MainRAM& ram, ProgramImage& image);
+
+/**
+ * @brief Lê os símbolos de código (STT_FUNC/STT_NOTYPE em seções
+ * executáveis) do ELF, ordenados por endereço. Não toca na RAM; retorna
+ * false se o arquivo não for ELF ou não tiver tabela de símbolos.
+ */
+bool load_elf_symbols(const std::string& filename, std::vector<ImageSymbol>& symbols);
+
+/**
+ * @brief Copia um binário "cru" (.bin) para a RAM a partir de 'base'.
+ */
+bool load_binary(const std::string& filename, MainRAM& ram, uint32_t base, ProgramImage& image);
+
+/**
+ * @brief Carrega um .hex ("@endereço" + uma palavra por linha) pelo Bus.
+ * Se 'cache_dir' não for vazio, a imagem analisada é guardada lá (chave:
+ * caminho + mtime + tamanho) e, nas próximas vezes, lida com um único
+ * mmap em vez de reanalisar o texto.
+ */
+bool load_hex(const std::string& filename, Bus& bus, uint32_t base_addr, ProgramImage& image,
+              const std::string& cache_dir = "");
+
+#endif // LOADER_H
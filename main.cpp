@@ -1,12 +1,27 @@
 #include <iostream>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <string>
 #include <filesystem>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "cpu.h"
 #include "bus.h"
 #include "ram.h"
+#include "loader.h"
+#include "profile.h"
+#include "smp.h"
+#include "snapshot.h"
+#include "trace.h"
 
 // ============================================================
 // CONSTANTES GLOBAIS
@@ -15,9 +30,178 @@
 const int MAX_CYCLES = 500000;
 // Define a pasta onde os relatórios serão salvos
 const std::string DUMP_DIR = "FAILURE_REPORTS";
+// Pasta padrão dos perfis (--profile)
+const std::string PROFILE_DIR = "PROFILES";
 
 namespace fs = std::filesystem;
 
+// ============================================================
+// ESTATÍSTICAS DA BATERIA (Somente a parte de execução da CPU)
+// ============================================================
+struct RunStats {
+    uint64_t instructions = 0; // Instruções executadas em todos os testes
+    double   seconds = 0.0;    // Tempo gasto dentro de cpu.run()
+    uint64_t icache_hits = 0;  // Buscas atendidas pela cache de decodificação
+    uint64_t icache_misses = 0;
+    double   load_seconds = 0.0; // Tempo gasto carregando as imagens
+    int      loads_cached = 0;   // Imagens .hex lidas da cache
+    uint64_t dirty_pages = 0;    // Páginas de 4 KB da RAM escritas (soma dos testes)
+    uint32_t dirty_max = 0;      // ... no teste que mais escreveu
+    uint64_t atomics = 0;        // LR/SC/AMOs (RV32A) executadas
+    uint64_t skipped = 0;        // Ciclos pulados (WFI e laços sem efeitos), fora de 'instructions'
+
+    void add(const RunStats& other) {
+        instructions += other.instructions;
+        seconds += other.seconds;
+        load_seconds += other.load_seconds;
+        loads_cached += other.loads_cached;
+        icache_hits += other.icache_hits;
+        icache_misses += other.icache_misses;
+        dirty_pages += other.dirty_pages;
+        dirty_max = std::max(dirty_max, other.dirty_max);
+        atomics += other.atomics;
+        skipped += other.skipped;
+    }
+};
+
+// ============================================================
+// OPÇÕES DE LINHA DE COMANDO
+// ============================================================
+// Uso: RiscV_1 [--engine=switch|threaded|blocks|jit|check] [--max-cycles=N] [--jit-threshold=N] [--ram-size=N[K|M]] [--huge-pages] [-j N] [--hex-cache=PASTA|--no-hex-cache] [--batch=N [--batch-slice=N]] [--snapshot-at=N [--snapshot-dir=PASTA]] [--harts=N [--smp=free|quantum] [--quantum=N]] [--profile[=PASTA]] [--trace-depth=N] [--trace-file] [--uart-input] [pasta|arquivo.hex|.elf|.bin]
+struct Options {
+    std::string path = "TESTES HEX RISCV\\"; // Pasta de testes (ou uma única imagem)
+    ExecEngine engine = ENGINE_SWITCH;
+    bool cross_check = false;  // 'check': roda em todos os motores e compara
+    int max_cycles = MAX_CYCLES;
+    int jit_threshold = 50;    // Execuções de um bloco antes de compilá-lo
+    uint32_t ram_size = MAIN_RAM_SIZE;
+    bool huge_pages = false;   // Pede páginas grandes ao SO para a RAM
+    int jobs = 1;              // Testes em paralelo (-j N; 0 = um por núcleo)
+    std::string hex_cache = "HEX_CACHE"; // Pasta da cache de .hex analisados ("" = desligada)
+    int batch = 0;             // Máquinas intercaladas numa thread (0 = desligado)
+    int batch_slice = 10000;   // Ciclos por fatia no modo --batch
+    int snapshot_at = 0;       // Snapshot + restauração após N ciclos (0 = desligado)
+    std::string snapshot_dir;  // Se definida, o snapshot passa por um arquivo nesta pasta
+    int harts = 1;             // Harts da máquina (um por thread do host)
+    SmpMode smp = SMP_FREE;    // Harts livres ou em quanta sincronizados
+    int quantum = 1000;        // Ciclos por quantum no modo --smp=quantum
+    std::string profile_dir;   // --profile: pasta dos perfis ("" = desligado)
+    uint32_t trace_depth = TraceRing::DEFAULT_DEPTH; // Instruções no anel de trace (0 = desligado)
+    bool trace_file = false;   // Grava também o anel em binário (<teste>.rvtrace) na falha
+    bool uart_input = false;   // O stdin do host alimenta o receptor da UART
+};
+
+// Tamanho em bytes com sufixo opcional K/M/G (ex.: 512K, 64M). 0 = inválido.
+uint32_t parse_size(const std::string& text)
+{
+    size_t used = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &used, 0);
+    } catch (...) {
+        return 0;
+    }
+    std::string suffix = text.substr(used);
+    if (suffix == "K" || suffix == "k") value <<= 10;
+    else if (suffix == "M" || suffix == "m") value <<= 20;
+    else if (suffix == "G" || suffix == "g") value <<= 30;
+    else if (!suffix.empty()) return 0;
+    if (value == 0 || value > MAIN_RAM_MAX_SIZE) return 0;
+    return (uint32_t)value;
+}
+
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=switch") {
+            opts.engine = ENGINE_SWITCH;
+        } else if (arg == "--engine=threaded") {
+            opts.engine = ENGINE_THREADED;
+        } else if (arg == "--engine=blocks") {
+            opts.engine = ENGINE_BLOCKS;
+        } else if (arg == "--engine=jit") {
+            opts.engine = ENGINE_JIT;
+        } else if (arg == "--engine=check") {
+            opts.engine = ENGINE_SWITCH;
+            opts.cross_check = true;
+        } else if (arg.rfind("--max-cycles=", 0) == 0) {
+            opts.max_cycles = std::stoi(arg.substr(13));
+        } else if (arg.rfind("--jit-threshold=", 0) == 0) {
+            opts.jit_threshold = std::stoi(arg.substr(16));
+        } else if (arg.rfind("--ram-size=", 0) == 0) {
+            opts.ram_size = parse_size(arg.substr(11));
+            if (opts.ram_size == 0) {
+                std::cerr << "ERRO: Tamanho de RAM inválido: " << arg.substr(11)
+                          << " (de 1 byte a 2G)\n";
+                return false;
+            }
+        } else if (arg == "--huge-pages") {
+            opts.huge_pages = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            opts.jobs = std::stoi(argv[++i]);
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            opts.jobs = std::stoi(arg.substr(2));
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            opts.jobs = std::stoi(arg.substr(7));
+        } else if (arg.rfind("--hex-cache=", 0) == 0) {
+            opts.hex_cache = arg.substr(12);
+        } else if (arg == "--no-hex-cache") {
+            opts.hex_cache.clear();
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            opts.batch = std::stoi(arg.substr(8));
+        } else if (arg.rfind("--batch-slice=", 0) == 0) {
+            opts.batch_slice = std::max(1, std::stoi(arg.substr(14)));
+        } else if (arg.rfind("--snapshot-at=", 0) == 0) {
+            opts.snapshot_at = std::stoi(arg.substr(14));
+        } else if (arg.rfind("--snapshot-dir=", 0) == 0) {
+            opts.snapshot_dir = arg.substr(15);
+        } else if (arg.rfind("--harts=", 0) == 0) {
+            opts.harts = std::max(1, std::stoi(arg.substr(8)));
+        } else if (arg == "--smp=free") {
+            opts.smp = SMP_FREE;
+        } else if (arg == "--smp=quantum") {
+            opts.smp = SMP_QUANTUM;
+        } else if (arg.rfind("--quantum=", 0) == 0) {
+            opts.quantum = std::max(1, std::stoi(arg.substr(10)));
+        } else if (arg == "--profile") {
+            opts.profile_dir = PROFILE_DIR;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            opts.profile_dir = arg.substr(10);
+        } else if (arg.rfind("--trace-depth=", 0) == 0) {
+            opts.trace_depth = (uint32_t)std::max(0, std::stoi(arg.substr(14)));
+        } else if (arg == "--trace-file") {
+            opts.trace_file = true;
+        } else if (arg == "--uart-input") {
+            opts.uart_input = true;
+        } else if (arg.rfind("-", 0) == 0) {
+            std::cerr << "ERRO: Opção desconhecida: " << arg << "\n"
+                      << "Uso: " << argv[0] << " [--engine=switch|threaded|blocks|jit|check] [--max-cycles=N] [--jit-threshold=N] [--ram-size=N[K|M]] [--huge-pages] [-j N] [--hex-cache=PASTA|--no-hex-cache] [--batch=N [--batch-slice=N]] [--snapshot-at=N [--snapshot-dir=PASTA]] [--harts=N [--smp=free|quantum] [--quantum=N]] [--profile[=PASTA]] [--trace-depth=N] [--trace-file] [--uart-input] [pasta|arquivo.hex|.elf|.bin]\n";
+            return false;
+        } else {
+            opts.path = arg;
+        }
+    }
+    if (opts.batch > 0 && (opts.cross_check || opts.snapshot_at > 0)) {
+        std::cerr << "ERRO: --batch não pode ser combinado com --engine=check nem com --snapshot-at\n";
+        return false;
+    }
+    if (opts.harts > 1 && (opts.cross_check || opts.snapshot_at > 0 || opts.batch > 0)) {
+        std::cerr << "ERRO: --harts não pode ser combinado com --engine=check, --snapshot-at nem --batch\n";
+        return false;
+    }
+    if (opts.uart_input && opts.cross_check) {
+        // A entrada chega no tempo do host: as reexecuções não a veriam no mesmo ciclo
+        std::cerr << "ERRO: --uart-input não pode ser combinado com --engine=check\n";
+        return false;
+    }
+    if (!opts.profile_dir.empty() && (opts.batch > 0 || opts.harts > 1)) {
+        std::cerr << "ERRO: --profile não pode ser combinado com --batch nem com --harts\n";
+        return false;
+    }
+    return true;
+}
+
 // ============================================================
 // FUNÇÃO AUXILIAR: GERA RELATÓRIO DE FALHA (FORA DA CPU)
 // ============================================================
@@ -35,7 +219,9 @@ void generate_failure_report(const CPU& cpu, const std::string& filename, uint32
     // ----------------------------------------------------
     // RESULTADO FINAL E CÓDIGO DE FALHA
     // ----------------------------------------------------
-    if (tohost_result == 0xFFFFFFFF) {
+    if (tohost_result == 0xFFFFFFFF && cpu.infinite_loop) {
+        outfile << "Resultado: FALHA (LAÇO INFINITO)\n";
+    } else if (tohost_result == 0xFFFFFFFF) {
         outfile << "Resultado: FALHA (TIMEOUT)\n";
     } else if (tohost_result != 1) {
         outfile << "Resultado: FALHA (tohost = 0x" << std::hex << tohost_result << ")\n";
@@ -45,7 +231,10 @@ void generate_failure_report(const CPU& cpu, const std::string& filename, uint32
     // DIAGNÓSTICO SIMPLIFICADO
     // ----------------------------------------------------
     outfile << "\n--- DIAGNÓSTICO ---\n";
-    if (tohost_result == 0xFFFFFFFF) {
+    if (tohost_result == 0xFFFFFFFF && cpu.infinite_loop) {
+        outfile << "Causa: A CPU parou num laço sem efeitos (ou WFI) em PC=0x" << std::hex << cpu.pc
+                << " do qual nenhum evento (interrupção, outro hart) pode tirá-la.\n";
+    } else if (tohost_result == 0xFFFFFFFF) {
         outfile << "Causa: A CPU atingiu o limite de ciclos. Indica loop infinito ou instrução que não termina.\n";
     } else if (cpu.mcause == 0xB) {
         // mcause 11 (0xB) é ECALL (Environment Call from M-mode), que é usado pelo Test Harness para reportar falha.
@@ -79,138 +268,709 @@ void generate_failure_report(const CPU& cpu, const std::string& filename, uint32
     outfile << "mcause:  0x" << std::hex << cpu.mcause << "\n";
     outfile << "mtvec:   0x" << std::hex << cpu.mtvec << "\n";
     outfile << "mie:     0x" << std::hex << cpu.mie << "\n";
+
+    // --- Últimas instruções (anel de trace) ---
+    outfile << "\n--- ÚLTIMAS " << std::dec << cpu.trace.depth() << " INSTRUÇÕES (mais antiga primeiro) ---\n";
+    write_trace_text(outfile, cpu);
     outfile.close();
 
-    std::cout << "\n[DUMP] Relatório de falha salvo em: " << filename << std::endl;
+    log_out() << "\n[DUMP] Relatório de falha salvo em: " << filename << std::endl;
 }
 
 
 /**
- * @brief Carrega um programa na memória a partir de um arquivo .hex.
+ * @brief Grava o perfil do teste (--profile): "<teste>.txt" com as funções
+ * e blocos mais quentes e "<teste>.folded" com as pilhas de chamadas
+ * (entrada do flamegraph.pl), simbolizados com 'symbols' (do ELF, se houver).
  */
-void loadProgramFromHexFile(const std::string& filename, Bus& bus, uint32_t base_addr) {
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
-        std::cerr << "[Loader] ERRO: Não foi possível abrir " << filename << std::endl;
+void write_profile(const fs::path& hex_file_path, const Profiler& profiler,
+                   const std::vector<ImageSymbol>& symbols, const Options& opts)
+{
+    std::error_code ec;
+    fs::create_directories(opts.profile_dir, ec);
+    fs::path base = fs::path(opts.profile_dir) / hex_file_path.stem();
+    std::string report = base.string() + ".txt";
+    std::string folded = base.string() + ".folded";
+
+    std::ofstream out(report);
+    out << "================================================\n";
+    out << "PERFIL: " << hex_file_path.filename().string() << "\n";
+    out << "================================================\n";
+    profiler.write_report(out, symbols, 20);
+    std::ofstream stacks(folded);
+    profiler.write_folded(stacks, symbols);
+    if (!out || !stacks) {
+        log_err() << "[PERFIL] ERRO: não foi possível gravar " << report << " / " << folded << "\n";
         return;
     }
+    log_out() << "[PERFIL] " << profiler.instructions() << " instruções | " << report << " | " << folded << "\n";
+}
 
-    std::cout << "[Loader] Carregando " << fs::path(filename).filename().string() << "...\n";
-
-    std::string line;
-    uint32_t current_addr = base_addr;
-
-    while (std::getline(infile, line)) {
-        line.erase(0, line.find_first_not_of(" \t\n\r\f\v"));
-        line.erase(line.find_last_not_of(" \t\n\r\f\v") + 1);
-        if (line.empty()) continue;
+/**
+ * @brief Carrega a imagem do teste (.hex, ELF ou .bin) e prepara o PC e
+ * o 'tohost'. Se o ELF tiver o símbolo 'tohost', a página dele passa a
+ * ser a dos Periféricos (e a página padrão volta a ser RAM), com a RAM
+ * por baixo: só as palavras 'tohost' e 'fromhost' são interceptadas, e os
+ * dados do ELF que dividem a página continuam valendo. O 'fromhost' tem
+ * de estar na mesma página; sem o símbolo, fica 64 bytes depois do
+ * 'tohost' (ou antes, no fim da página).
+ */
+bool load_test_image(const fs::path& path, MainRAM& ram, Bus& bus, Peripherals& peripherals, CPU& cpu,
+                     const Options& opts, ProgramImage& image)
+{
+    bool ok = false;
+    switch (detect_image_format(path.string())) {
+    case IMAGE_HEX: ok = load_hex(path.string(), bus, MAIN_RAM_START, image, opts.hex_cache); break;
+    case IMAGE_ELF: ok = load_elf(path.string(), ram, image); break;
+    case IMAGE_BIN: ok = load_binary(path.string(), ram, MAIN_RAM_START, image); break;
+    default:
+        log_err() << "[Loader] ERRO: Formato de imagem desconhecido: " << path.filename().string() << "\n";
+        break;
+    }
+    if (!ok) return false;
 
-        if (line[0] == '@') {
-            std::stringstream ss;
-            ss << std::hex << line.substr(1);
-            ss >> current_addr;
-            continue;
+    if (image.has_tohost) {
+        uint32_t page = image.tohost & ~Bus::PAGE_MASK;
+        if (page != PERIPHERALS_START) {
+            bus.mapRam(PERIPHERALS_START, PERIPHERALS_SIZE, ram.data() + (PERIPHERALS_START - MAIN_RAM_START));
+            bus.mapMmio(page, Bus::PAGE_SIZE, &peripherals);
+        }
+        peripherals.backWithRam(ram, page);
+        peripherals.tohost_offset = image.tohost & Bus::PAGE_MASK;
+        uint32_t after = peripherals.tohost_offset + Peripherals::LOCAL_FROMHOST_ADDR;
+        peripherals.fromhost_offset = after < Bus::PAGE_SIZE ? after : peripherals.tohost_offset - Peripherals::LOCAL_FROMHOST_ADDR;
+        if (image.has_fromhost) {
+            if ((image.fromhost & ~Bus::PAGE_MASK) == page)
+                peripherals.fromhost_offset = image.fromhost & Bus::PAGE_MASK;
+            else
+                log_err() << "[Loader] AVISO: 'fromhost' (0x" << std::hex << image.fromhost
+                          << ") fora da página do 'tohost'; usando 0x" << (page + peripherals.fromhost_offset)
+                          << std::dec << "\n";
         }
-
-        std::stringstream ss(line);
-        uint32_t value;
-        ss >> std::hex >> value;
-        if (ss.fail()) continue;
-
-        bus.writeWord(current_addr, value);
-        current_addr += 4;
     }
-    std::cout << "[Loader] Carregamento concluído.\n";
+    if (image.entry != cpu.pc) cpu.setPC(image.entry);
+    return true;
 }
 
 /**
- * @brief Executa um único teste, gera dump em caso de falha.
+ * @brief Reexecuta a imagem com outro motor e compara o estado final com
+ * o da execução de referência (motor switch).
  */
-bool run_single_test(const fs::path& hex_file_path) {
-    std::cout << "--- EXECUTANDO: " << hex_file_path.filename().string() << " ---\n";
-
-    // 1. Reinicializa todo o hardware.
-    MainRAM ram;
+bool cross_check_engine(const fs::path& hex_file_path, ExecEngine engine, const char* engine_name,
+                        MainRAM& ram, const CPU& ref, const Peripherals& ref_io, const Options& opts) {
+    ram.reset();
     VRAM vram;
     Peripherals peripherals;
+    peripherals.htif.quiet = true; // A saída do guest já saiu na execução de referência
+    peripherals.htif.replay_input = &ref_io.htif.input_log; // E o stdin já foi lido por ela
+    peripherals.uart.quiet = true;
     Bus bus(&ram, &vram, &peripherals);
     CPU cpu;
+    cpu.engine = engine;
+    cpu.jit_threshold = opts.jit_threshold;
+
+    ProgramImage image;
+    if (!load_test_image(hex_file_path, ram, bus, peripherals, cpu, opts, image)) return false;
+    cpu.run(bus, opts.max_cycles);
+
+    bool same = (cpu.pc == ref.pc && cpu.cycle_count == ref.cycle_count &&
+                 peripherals.simulation_should_halt == ref_io.simulation_should_halt &&
+                 peripherals.test_result == ref_io.test_result);
+    for (int i = 0; i < 32; ++i)
+        if (cpu.regs[i] != ref.regs[i]) same = false;
+    for (int i = 0; i < HPM_EVENT_COUNT; ++i)
+        if (cpu.hpm_events[i] != ref.hpm_events[i]) same = false;
+
+    if (same) {
+        log_out() << "[CHECK] Motores switch e " << engine_name << " concordam.\n";
+    } else {
+        log_out() << "[CHECK] \033[1;31mDIVERGÊNCIA\033[0m entre os motores (switch x " << engine_name << "):\n"
+                  << "  PC: 0x" << std::hex << ref.pc << " x 0x" << cpu.pc << std::dec
+                  << " | Ciclos: " << ref.cycle_count << " x " << cpu.cycle_count << "\n";
+        for (int i = 0; i < 32; ++i)
+            if (cpu.regs[i] != ref.regs[i])
+                log_out() << "  x" << i << " (" << cpu.get_abi_name(i) << "): 0x" << std::hex
+                          << ref.regs[i] << " x 0x" << cpu.regs[i] << std::dec << "\n";
+        for (int i = 0; i < HPM_EVENT_COUNT; ++i)
+            if (cpu.hpm_events[i] != ref.hpm_events[i])
+                log_out() << "  Evento " << i << " dos mhpmcounters: " << ref.hpm_events[i]
+                          << " x " << cpu.hpm_events[i] << "\n";
+    }
+    return same;
+}
+
+/**
+ * @brief Carrega a imagem cronometrando a carga (estatísticas + linha
+ * "[Loader]"). Em caso de erro, já imprime o resultado do teste.
+ */
+bool load_timed(const fs::path& hex_file_path, MainRAM& ram, Bus& bus, Peripherals& peripherals, CPU& cpu,
+                RunStats& stats, const Options& opts)
+{
+    ProgramImage image;
+    auto t_load = std::chrono::steady_clock::now();
+    if (!load_test_image(hex_file_path, ram, bus, peripherals, cpu, opts, image)) {
+        log_out() << ">>> RESULTADO: \033[1;31mFAIL (CARGA)\033[0m\n";
+        return false;
+    }
+    std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - t_load;
+    stats.load_seconds += load_time.count();
+    if (image.from_cache) stats.loads_cached++;
+    log_out() << "[Loader] " << image.bytes << " bytes em " << std::fixed << std::setprecision(1)
+              << (load_time.count() * 1e6) << " us" << (image.from_cache ? " (cache)" : "")
+              << std::defaultfloat << "\n";
+    return true;
+}
 
-    // 2. Carrega o programa
-    loadProgramFromHexFile(hex_file_path.string(), bus, MAIN_RAM_START);
+// Escreve o que sobrou da saída do guest (fd 1 do HTIF e UART) e resume
+// as chamadas de sistema e o tráfego da UART
+void finish_console(Peripherals& peripherals)
+{
+    peripherals.htif.flush();
+    peripherals.uart.flush();
+    if (peripherals.htif.syscalls)
+        log_out() << "[HTIF] " << peripherals.htif.syscalls << " chamadas de sistema, "
+                  << peripherals.htif.console_bytes << " bytes no console\n";
+    if (peripherals.uart.tx_bytes || peripherals.uart.rx_bytes)
+        log_out() << "[UART] " << peripherals.uart.tx_bytes << " bytes transmitidos, "
+                  << peripherals.uart.rx_bytes << " recebidos\n";
+}
 
-    // 3. Executa a simulação
-    cpu.run(bus, MAX_CYCLES);
+// Soma a execução de um teste às estatísticas (e imprime as páginas sujas)
+void record_run(const CPU& cpu, const MainRAM& ram, double seconds, RunStats& stats)
+{
+    uint64_t skipped = cpu.idle_cycles + cpu.spin_skipped;
+    stats.instructions += cpu.cycle_count - skipped;
+    stats.skipped += skipped;
+    stats.seconds += seconds;
+    stats.icache_hits += cpu.icache.hits;
+    stats.icache_misses += cpu.icache.misses;
+    stats.atomics += cpu.atomics;
+    uint32_t dirty = ram.dirtyPages(); // Imagem + tudo o que o programa escreveu
+    stats.dirty_pages += dirty;
+    stats.dirty_max = std::max(stats.dirty_max, dirty);
+    log_out() << "[RAM] " << dirty << " páginas sujas (" << (dirty * 4) << " KB)\n";
+}
 
+/**
+ * @brief Imprime PASS/FAIL a partir do 'tohost' e gera o relatório de
+ * falha (FAIL ou TIMEOUT).
+ */
+bool report_result(const fs::path& hex_file_path, const CPU& cpu, const Peripherals& peripherals,
+                   const Options& opts)
+{
     // Variáveis para dump
     uint32_t final_result = 0;
     std::string dump_filename = DUMP_DIR + "/" + hex_file_path.stem().string() + ".txt";
+    std::string trace_filename = DUMP_DIR + "/" + hex_file_path.stem().string() + ".rvtrace";
 
-    // 4. Verifica o resultado
-    if (bus.peripherals->simulation_should_halt) {
-        final_result = bus.peripherals->test_result;
+    if (peripherals.simulation_should_halt) {
+        final_result = peripherals.test_result;
 
         if (final_result == 1) {
-            std::cout << ">>> RESULTADO: \033[1;32mPASS\033[0m\n";
+            log_out() << ">>> RESULTADO: \033[1;32mPASS\033[0m\n";
             return true;
         } else {
-            std::cout << ">>> RESULTADO: \033[1;31mFAIL\033[0m (tohost = 0x"
+            log_out() << ">>> RESULTADO: \033[1;31mFAIL\033[0m (tohost = 0x"
                       << std::hex << final_result << std::dec << ")\n";
             // CHAMA A FUNÇÃO EXTERNA DE DUMP EM CASO DE FALHA
-            generate_failure_report(cpu, dump_filename, final_result, MAX_CYCLES);
+            generate_failure_report(cpu, dump_filename, final_result, opts.max_cycles);
+            if (opts.trace_file) write_trace_binary(trace_filename, cpu);
             return false;
         }
     } else {
         final_result = 0xFFFFFFFF; // Código para indicar TIMEOUT
-        std::cout << ">>> RESULTADO: \033[1;31mFAIL (TIMEOUT)\033[0m\n";
+        if (cpu.infinite_loop)
+            log_out() << ">>> RESULTADO: \033[1;31mFAIL (LAÇO INFINITO em PC=0x" << std::hex << cpu.pc
+                      << std::dec << ")\033[0m\n";
+        else
+            log_out() << ">>> RESULTADO: \033[1;31mFAIL (TIMEOUT)\033[0m\n";
         // CHAMA A FUNÇÃO EXTERNA DE DUMP EM CASO DE TIMEOUT
-        generate_failure_report(cpu, dump_filename, final_result, MAX_CYCLES);
+        generate_failure_report(cpu, dump_filename, final_result, opts.max_cycles);
+        if (opts.trace_file) write_trace_binary(trace_filename, cpu);
+        return false;
+    }
+}
+
+/**
+ * @brief Captura a máquina, opcionalmente grava/relê o snapshot em disco
+ * (--snapshot-dir) e restaura a máquina a partir dele.
+ */
+bool snapshot_round_trip(const fs::path& hex_file_path, CPU& cpu, MainRAM& ram, Peripherals& peripherals,
+                         const Options& opts)
+{
+    MachineSnapshot snap;
+    take_snapshot(cpu, ram, peripherals, snap);
+
+    if (!opts.snapshot_dir.empty()) {
+        std::error_code ec;
+        fs::create_directories(opts.snapshot_dir, ec);
+        std::string file = (fs::path(opts.snapshot_dir) / (hex_file_path.stem().string() + ".rvsn")).string();
+        MachineSnapshot from_disk;
+        if (!save_snapshot_file(snap, file) || !load_snapshot_file(file, from_disk)) {
+            log_out() << ">>> RESULTADO: \033[1;31mFAIL (SNAPSHOT)\033[0m\n";
+            return false;
+        }
+        snap = std::move(from_disk);
+    }
+
+    auto t_restore = std::chrono::steady_clock::now();
+    if (!restore_snapshot(snap, cpu, ram, peripherals)) {
+        log_out() << ">>> RESULTADO: \033[1;31mFAIL (SNAPSHOT)\033[0m\n";
+        return false;
+    }
+    std::chrono::duration<double> restore_time = std::chrono::steady_clock::now() - t_restore;
+    log_out() << "[Snapshot] Ciclo " << snap.cycle_count << ": " << snap.page_index.size() << " páginas ("
+              << (snap.bytes() / 1024) << " KB), restaurado em " << std::fixed << std::setprecision(1)
+              << (restore_time.count() * 1e6) << " us" << std::defaultfloat << "\n";
+    return true;
+}
+
+/**
+ * @brief Executa um único teste, gera dump em caso de falha.
+ */
+bool run_single_test(const fs::path& hex_file_path, MainRAM& ram, RunStats& stats, const Options& opts) {
+    log_out() << "--- EXECUTANDO: " << hex_file_path.filename().string() << " ---\n";
+
+    // 1. Reinicializa todo o hardware (a RAM é reaproveitada entre os
+    //    testes: 'reset' só zera as páginas que o teste anterior escreveu).
+    ram.reset();
+    VRAM vram;
+    Peripherals peripherals;
+    Bus bus(&ram, &vram, &peripherals);
+    CPU cpu;
+    cpu.engine = opts.engine;
+    cpu.jit_threshold = opts.jit_threshold;
+    if (opts.trace_depth != TraceRing::DEFAULT_DEPTH) cpu.trace.resize(opts.trace_depth);
+
+    // 2. Carrega o programa (.hex, ELF ou .bin), também cronometrado
+    if (!load_timed(hex_file_path, ram, bus, peripherals, cpu, stats, opts))
         return false;
+    if (opts.uart_input) peripherals.uart.setInput(0);
+    peripherals.htif.record_input = opts.cross_check; // Para as reexecuções lerem o mesmo stdin
+
+    // --profile: conta a partir do ponto de entrada (raiz da pilha)
+    Profiler profiler;
+    std::vector<ImageSymbol> symbols;
+    if (!opts.profile_dir.empty()) {
+        if (detect_image_format(hex_file_path.string()) == IMAGE_ELF)
+            load_elf_symbols(hex_file_path.string(), symbols);
+        profiler.start(ram.size(), cpu.pc, symbols);
+        cpu.profiler = &profiler;
+    }
+
+    // 3. Executa a simulação (cronometrada para o cálculo de MIPS)
+    auto t_start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed(0);
+    if (opts.harts > 1) {
+        // 3a. --harts: os outros harts começam no mesmo ponto de entrada,
+        //     cada um com sua porta no barramento e sua thread
+        std::vector<std::unique_ptr<Hart>> harts;
+        std::vector<CPU*> cpus = { &cpu };
+        std::vector<Bus*> buses = { &bus };
+        {
+            std::ostringstream quiet; // Só o hart 0 anuncia a CPU
+            std::ostream* previous = log_stream;
+            log_stream = &quiet;
+            for (int h = 1; h < opts.harts; ++h) {
+                harts.emplace_back(new Hart(bus));
+                harts.back()->cpu.engine = opts.engine;
+                harts.back()->cpu.jit_threshold = opts.jit_threshold;
+                boot_hart(harts.back()->cpu, h, opts.harts, cpu.pc);
+                cpus.push_back(&harts.back()->cpu);
+                buses.push_back(&harts.back()->bus);
+            }
+            log_stream = previous;
+        }
+        boot_hart(cpu, 0, opts.harts, cpu.pc);
+        peripherals.uart.shared = true; // Harts em threads diferentes
+        t_start = std::chrono::steady_clock::now();
+        run_smp(cpus, buses, opts.max_cycles, opts.smp, opts.quantum);
+        for (size_t h = 1; h < cpus.size(); ++h) {
+            uint64_t skipped = cpus[h]->idle_cycles + cpus[h]->spin_skipped;
+            stats.instructions += cpus[h]->cycle_count - skipped;
+            stats.skipped += skipped;
+            stats.atomics += cpus[h]->atomics;
+        }
+    } else if (opts.snapshot_at > 0 && opts.snapshot_at < opts.max_cycles) {
+        // 3b. --snapshot-at: para no ciclo N, captura a máquina, restaura
+        //     (RAM zerada + páginas do snapshot) e continua dali
+        cpu.run(bus, opts.snapshot_at);
+        elapsed += std::chrono::steady_clock::now() - t_start;
+        if (cpu.running && !peripherals.simulation_should_halt &&
+            !snapshot_round_trip(hex_file_path, cpu, ram, peripherals, opts))
+            return false;
+        t_start = std::chrono::steady_clock::now();
+        cpu.resume(bus, opts.max_cycles);
+    } else {
+        cpu.run(bus, opts.max_cycles);
+    }
+    elapsed += std::chrono::steady_clock::now() - t_start;
+    finish_console(peripherals);
+    record_run(cpu, ram, elapsed.count(), stats);
+    if (cpu.profiler) write_profile(hex_file_path, profiler, symbols, opts);
+
+    // 3c. Validação cruzada dos motores (--engine=check)
+    if (opts.cross_check) {
+        bool same = cross_check_engine(hex_file_path, ENGINE_THREADED, "threaded", ram, cpu, peripherals, opts);
+        same = cross_check_engine(hex_file_path, ENGINE_BLOCKS, "blocks", ram, cpu, peripherals, opts) && same;
+        same = cross_check_engine(hex_file_path, ENGINE_JIT, "jit", ram, cpu, peripherals, opts) && same;
+        if (!same) return false;
+    }
+
+    // 4. Verifica o resultado
+    return report_result(hex_file_path, cpu, peripherals, opts);
+}
+
+// ============================================================
+// EXECUÇÃO PARALELA (-j N)
+// ============================================================
+/**
+ * @struct TestOutcome
+ * @brief Resultado de um teste rodado por um worker. A saída fica no
+ * buffer até chegar a vez do teste de ser impresso.
+ */
+struct TestOutcome {
+    bool done = false;
+    bool passed = false;
+    std::string log;
+    RunStats stats;
+};
+
+/**
+ * @brief Roda os testes em 'jobs' threads. Os workers tiram o próximo
+ * teste de uma fila compartilhada (um índice atômico), cada um com sua
+ * própria MainRAM, e gravam a saída do teste em um buffer. A thread
+ * principal imprime os buffers na ordem de 'test_files' assim que cada
+ * um fica pronto, então a saída é igual à do modo serial.
+ */
+void run_parallel(const std::vector<fs::path>& test_files, int jobs, const Options& opts,
+                  std::vector<bool>& passed, RunStats& stats)
+{
+    std::vector<TestOutcome> outcomes(test_files.size());
+    std::atomic<size_t> next(0);
+    std::mutex mutex;
+    std::condition_variable ready;
+
+    // Uma RAM por worker. Só a primeira anuncia o módulo, como no modo
+    // serial, para que a saída não dependa do número de threads.
+    std::vector<std::unique_ptr<MainRAM>> rams;
+    rams.emplace_back(new MainRAM(opts.ram_size, opts.huge_pages));
+    {
+        std::ostringstream quiet;
+        log_stream = &quiet;
+        for (int t = 1; t < jobs; ++t)
+            rams.emplace_back(new MainRAM(opts.ram_size, opts.huge_pages));
+        log_stream = nullptr;
+    }
+
+    auto worker = [&](MainRAM& ram) {
+        for (size_t i = next++; i < test_files.size(); i = next++) {
+            std::ostringstream buffer;
+            log_stream = &buffer;
+            RunStats local;
+            bool ok = run_single_test(test_files[i], ram, local, opts);
+            buffer << "---------------------------------\n\n";
+            log_stream = nullptr;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            outcomes[i].passed = ok;
+            outcomes[i].log = buffer.str();
+            outcomes[i].stats = local;
+            outcomes[i].done = true;
+            ready.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < jobs; ++t) workers.emplace_back(worker, std::ref(*rams[t]));
+
+    for (size_t i = 0; i < test_files.size(); ++i) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return outcomes[i].done; });
+        std::cout << outcomes[i].log;
+        passed[i] = outcomes[i].passed;
+        stats.add(outcomes[i].stats);
+        outcomes[i].log.clear();
+    }
+    for (std::thread& t : workers) t.join();
+}
+
+// ============================================================
+// EXECUÇÃO EM LOTE (--batch=N)
+// ============================================================
+/**
+ * @struct SharedImage
+ * @brief Conteúdo da RAM logo após a carga de um programa do lote e a
+ * cache de decodificação compartilhada pelas máquinas que carregaram
+ * exatamente o mesmo conteúdo (mesmo que de arquivos diferentes).
+ */
+struct SharedImage {
+    uint64_t hash = 0;
+    std::vector<uint32_t> pages; // Páginas sujas após a carga
+    std::vector<uint8_t> data;   // Conteúdo delas
+    DecodeCache cache;
+    int users = 0;               // Máquinas rodando esta imagem
+
+    bool same(const MainRAM& ram, const std::vector<uint32_t>& loaded) const {
+        if (loaded != pages) return false;
+        for (size_t i = 0; i < pages.size(); ++i)
+            if (std::memcmp(ram.data() + (size_t)pages[i] * 4096, data.data() + i * 4096, 4096) != 0)
+                return false;
+        return true;
+    }
+};
+
+/**
+ * @struct BatchSlot
+ * @brief Uma das N máquinas do lote. É montada uma única vez e
+ * reaproveitada para vários programas: entre eles, a RAM só zera as
+ * páginas sujas e CPU, Periféricos e mapa do Bus voltam ao estado inicial.
+ */
+struct BatchSlot {
+    MainRAM ram;
+    VRAM vram;
+    Peripherals peripherals;
+    Bus bus;
+    CPU cpu;
+    size_t test = 0;     // Índice do programa em execução
+    bool active = false;
+    SharedImage* image = nullptr; // Cache de decodificação em uso
+    double seconds = 0.0; // Tempo de CPU do programa (soma das fatias)
+    std::ostringstream log;
+
+    BatchSlot(uint32_t ram_size, bool huge_pages)
+        : ram(ram_size, huge_pages), bus(&ram, &vram, &peripherals) {}
+};
+
+/**
+ * @brief Roda os programas em N máquinas intercaladas numa única thread:
+ * cada máquina ativa executa uma fatia de 'batch_slice' ciclos por vez e,
+ * ao terminar, recebe o próximo programa da fila. Máquinas que carregaram
+ * o mesmo conteúdo compartilham a cache de decodificação
+ * (DecodeCache::share), então cada imagem é decodificada uma vez só. A saída de cada programa fica no buffer da
+ * máquina e é impressa na ordem dos arquivos, como no modo serial.
+ */
+void run_batch(const std::vector<fs::path>& test_files, int slots, const Options& opts,
+               std::vector<bool>& passed, RunStats& stats)
+{
+    std::vector<std::unique_ptr<BatchSlot>> machines;
+    {
+        std::ostringstream quiet; // Banners dos módulos: uma vez só, aqui não
+        log_stream = &quiet;
+        for (int i = 0; i < slots; ++i) {
+            machines.emplace_back(new BatchSlot(opts.ram_size, opts.huge_pages));
+            machines.back()->cpu.trace.resize(opts.trace_depth);
+        }
+        log_stream = nullptr;
     }
+
+    // Imagens já vistas. As que ficam sem máquinas são mantidas (o mesmo
+    // programa tende a voltar) até 4 por máquina; além disso, são liberadas.
+    std::vector<std::unique_ptr<SharedImage>> images;
+    const size_t max_images = 4 * (size_t)slots;
+
+    // Procura (ou registra) a imagem que acabou de ser carregada na máquina
+    auto find_image = [&](const MainRAM& ram) {
+        std::vector<uint32_t> loaded;
+        ram.dirtyPageList(loaded, false);
+        uint64_t hash = 1469598103934665603ull; // FNV-1a das páginas carregadas
+        for (uint32_t page : loaded) {
+            const uint8_t* p = ram.data() + (size_t)page * 4096;
+            hash = (hash ^ page) * 1099511628211ull;
+            for (uint32_t i = 0; i < 4096; i += 8) {
+                uint64_t v;
+                std::memcpy(&v, p + i, 8);
+                hash = (hash ^ v) * 1099511628211ull;
+            }
+        }
+        for (auto& img : images)
+            if (img->hash == hash && img->same(ram, loaded)) return img.get();
+
+        SharedImage* img = new SharedImage();
+        img->hash = hash;
+        img->pages = loaded;
+        for (uint32_t page : loaded)
+            img->data.insert(img->data.end(), ram.data() + (size_t)page * 4096,
+                             ram.data() + (size_t)page * 4096 + 4096);
+        img->cache.resize(ram.size());
+        images.emplace_back(img);
+        return img;
+    };
+
+    std::vector<TestOutcome> outcomes(test_files.size());
+    size_t next = 0, printed = 0;
+
+    auto start = [&](BatchSlot& m) {
+        m.test = next++;
+        m.active = true;
+        m.seconds = 0.0;
+        m.log.str("");
+        log_stream = &m.log;
+        const fs::path& file = test_files[m.test];
+        log_out() << "--- EXECUTANDO: " << file.filename().string() << " ---\n";
+
+        m.ram.reset();
+        m.peripherals.reset();
+        m.bus.mapDefault();
+        m.cpu.reset();
+        m.cpu.engine = opts.engine;
+        m.cpu.jit_threshold = opts.jit_threshold;
+
+        if (load_timed(file, m.ram, m.bus, m.peripherals, m.cpu, outcomes[m.test].stats, opts)) {
+            m.image = find_image(m.ram);
+            m.image->users++;
+            m.cpu.icache.resize(m.ram.size());
+            m.cpu.icache.share(&m.image->cache);
+            if (opts.uart_input) m.peripherals.uart.setInput(0);
+        } else {
+            m.active = false;
+        }
+        log_stream = nullptr;
+    };
+
+    auto finish = [&](BatchSlot& m) {
+        TestOutcome& out = outcomes[m.test];
+        log_stream = &m.log;
+        finish_console(m.peripherals);
+        record_run(m.cpu, m.ram, m.seconds, out.stats);
+        out.passed = report_result(test_files[m.test], m.cpu, m.peripherals, opts);
+        log_stream = nullptr;
+        m.active = false;
+    };
+
+    auto retire = [&](BatchSlot& m) {
+        TestOutcome& out = outcomes[m.test];
+        m.log << "---------------------------------\n\n";
+        out.log = m.log.str();
+        out.done = true;
+        if (!m.image) return;
+        m.cpu.icache.flush(); // Larga a imagem antes que ela possa ser liberada
+        if (--m.image->users == 0 && images.size() > max_images) {
+            for (size_t i = 0; i < images.size(); ++i)
+                if (images[i].get() == m.image) { images.erase(images.begin() + i); break; }
+        }
+        m.image = nullptr;
+    };
+
+    // Imprime, na ordem, tudo o que já terminou
+    auto print_ready = [&] {
+        for (; printed < test_files.size() && outcomes[printed].done; ++printed) {
+            std::cout << outcomes[printed].log;
+            passed[printed] = outcomes[printed].passed;
+            stats.add(outcomes[printed].stats);
+            std::string().swap(outcomes[printed].log);
+        }
+    };
+
+    // Carrega o próximo programa da fila na máquina (pula os que não carregam)
+    auto refill = [&](BatchSlot& m) {
+        while (!m.active && next < test_files.size()) {
+            start(m);
+            if (!m.active) retire(m);
+        }
+    };
+
+    for (auto& m : machines) refill(*m);
+
+    bool any_active = true;
+    while (any_active) {
+        any_active = false;
+        for (auto& slot : machines) {
+            BatchSlot& m = *slot;
+            if (!m.active) continue;
+
+            log_stream = &m.log;
+            auto t_slice = std::chrono::steady_clock::now();
+            int limit = (int)std::min<int64_t>(opts.max_cycles, (int64_t)m.cpu.cycle_count + opts.batch_slice);
+            m.cpu.run_slice(m.bus, limit);
+            m.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t_slice).count();
+            log_stream = nullptr;
+
+            if (m.cpu.running && !m.peripherals.simulation_should_halt && m.cpu.cycle_count < opts.max_cycles) {
+                any_active = true;
+                continue;
+            }
+            finish(m);
+            retire(m);
+            refill(m);
+            any_active = any_active || m.active;
+        }
+        print_ready();
+    }
+    print_ready();
 }
 
 // ============================================================
 // Função principal
 // ============================================================
-int main() {
+int main(int argc, char* argv[]) {
+
+    Options opts;
+    if (!parse_options(argc, argv, opts))
+        return 1;
 
     // Define o caminho para a pasta de testes
-    const std::string path_str = "TESTES HEX RISCV\\";
+    const std::string& path_str = opts.path;
     fs::path test_directory(path_str);
 
     // Cria o diretório de dumps se não existir
     fs::create_directories(DUMP_DIR);
 
-    int pass_count = 0;
-    int fail_count = 0;
+    RunStats stats;
 
     std::cout << "================================================\n";
     std::cout << "--- Iniciando Bateria de Testes RISC-V ---\n";
     std::cout << "--- Diretório: " << path_str << " ---\n";
     std::cout << "================================================\n\n";
 
+    // Um único arquivo (.hex, ELF ou .bin) também é aceito
+    std::vector<fs::path> test_files;
+    if (fs::is_regular_file(test_directory)) {
+        test_files.push_back(test_directory);
+    }
     // Verifica se o diretório de testes existe
-    if (!fs::exists(test_directory) || !fs::is_directory(test_directory)) {
+    else if (!fs::exists(test_directory) || !fs::is_directory(test_directory)) {
         std::cerr << "ERRO: Diretório de testes não encontrado ou inválido:\n"
                   << path_str << std::endl;
         return 1;
     }
+    else {
+        // Varre todos os arquivos no diretório
+        for (const auto& entry : fs::directory_iterator(test_directory)) {
+            // Verifica se é um arquivo regular com extensão de imagem
+            std::string ext = entry.path().extension().string();
+            if (entry.is_regular_file() && (ext == ".hex" || ext == ".elf" || ext == ".bin"))
+                test_files.push_back(entry.path());
+        }
+    }
+    // A ordem do 'directory_iterator' não é definida: ordena pelo nome
+    std::sort(test_files.begin(), test_files.end());
 
-    // Varre todos os arquivos no diretório
-    for (const auto& entry : fs::directory_iterator(test_directory)) {
+    int jobs = opts.jobs > 0 ? opts.jobs : (int)std::thread::hardware_concurrency();
+    jobs = std::max(1, std::min(jobs, (int)test_files.size()));
 
-        // Verifica se é um arquivo regular com a extensão .hex
-        if (entry.is_regular_file() && entry.path().extension() == ".hex") {
+    std::vector<bool> passed(test_files.size(), false);
+    auto wall_start = std::chrono::steady_clock::now();
 
+    if (opts.batch > 0) {
+        jobs = 1;
+        run_batch(test_files, std::min(opts.batch, std::max(1, (int)test_files.size())), opts, passed, stats);
+    } else if (jobs > 1) {
+        run_parallel(test_files, jobs, opts, passed, stats);
+    } else {
+        // RAM única para toda a bateria (mmap: criação O(1), reset por madvise)
+        MainRAM ram(opts.ram_size, opts.huge_pages);
+
+        for (size_t i = 0; i < test_files.size(); ++i) {
             // Executa o teste para este arquivo
-            if (run_single_test(entry.path())) {
-                pass_count++;
-            } else {
-                fail_count++;
-            }
+            passed[i] = run_single_test(test_files[i], ram, stats, opts);
             std::cout << "---------------------------------\n\n";
         }
     }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+
+    int pass_count = (int)std::count(passed.begin(), passed.end(), true);
+    int fail_count = (int)passed.size() - pass_count;
 
     // Imprime o resumo final
     std::cout << "================================================\n";
@@ -218,6 +978,37 @@ int main() {
     std::cout << "Testes Passaram: \033[1;32m" << pass_count << "\033[0m\n";
     std::cout << "Testes Falharam: \033[1;31m" << fail_count << "\033[0m\n";
     std::cout << "Total de Testes: " << (pass_count + fail_count) << "\n";
+    for (size_t i = 0; i < test_files.size(); ++i)
+        if (!passed[i])
+            std::cout << "  FALHOU: " << test_files[i].filename().string() << "\n";
+    std::cout << "Tempo Total: " << std::fixed << std::setprecision(3) << (wall.count() * 1000.0)
+              << " ms (" << jobs << (jobs > 1 ? " threads" : " thread");
+    if (opts.batch > 0) std::cout << ", lote de " << opts.batch << " máquinas";
+    if (opts.harts > 1) std::cout << ", " << opts.harts << " harts por teste";
+    std::cout << ")\n" << std::defaultfloat;
+    if (wall.count() > 0.0)
+        std::cout << "Vazão: " << std::fixed << std::setprecision(1) << (test_files.size() / wall.count())
+                  << " testes/s\n" << std::defaultfloat;
+    std::cout << "Instruções Executadas: " << std::dec << stats.instructions
+              << " em " << std::fixed << std::setprecision(3) << (stats.seconds * 1000.0) << " ms";
+    if (stats.seconds > 0.0)
+        std::cout << " (" << std::setprecision(2) << (stats.instructions / stats.seconds / 1e6) << " MIPS)";
+    std::cout << std::defaultfloat << "\n";
+    std::cout << "Carga das Imagens: " << std::fixed << std::setprecision(3) << (stats.load_seconds * 1000.0)
+              << " ms (" << stats.loads_cached << " da cache)" << std::defaultfloat << "\n";
+    std::cout << "Cache de Decodificação: " << stats.icache_hits << " acertos / "
+              << stats.icache_misses << " faltas\n";
+    std::cout << "Páginas Sujas (4 KB): " << stats.dirty_pages << " no total, até "
+              << stats.dirty_max << " por teste\n";
+    if (stats.skipped > 0)
+        std::cout << "Ciclos Pulados (WFI e laços sem efeitos): " << stats.skipped << "\n";
+    if (stats.atomics > 0) {
+        std::cout << "Operações Atômicas: " << stats.atomics;
+        if (stats.seconds > 0.0)
+            std::cout << " (" << std::fixed << std::setprecision(2) << (stats.atomics / stats.seconds / 1e6)
+                      << " M/s)" << std::defaultfloat;
+        std::cout << "\n";
+    }
     std::cout << "================================================\n";
 
     return 0;
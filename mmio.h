@@ -0,0 +1,28 @@
+#ifndef MMIO_H
+#define MMIO_H
+
+#include <cstdint>
+
+/**
+ * @class MmioDevice
+ * @brief Interface de um dispositivo mapeado em memória.
+ *
+ * O Bus mapeia páginas inteiras de 4 KB para o dispositivo e repassa cada
+ * acesso com o deslocamento relativo à base do mapeamento. 'size' é 1, 2
+ * ou 4 bytes; o valor lido/escrito está nos bits menos significativos.
+ *
+ * Por padrão uma escrita força um ponto de serviço do agendador da CPU
+ * logo depois da instrução (o dispositivo pode ter pedido algo a ela);
+ * um dispositivo que a CPU não precisa atender devolve false em
+ * 'serviceOnWrite'.
+ */
+class MmioDevice {
+public:
+    virtual ~MmioDevice() {}
+
+    virtual uint32_t mmioRead(uint32_t offset, uint32_t size) = 0;
+    virtual void mmioWrite(uint32_t offset, uint32_t data, uint32_t size) = 0;
+    virtual bool serviceOnWrite() const { return true; }
+};
+
+#endif // MMIO_H
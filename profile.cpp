@@ -0,0 +1,322 @@
+#include "profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+
+// ============================================================
+//  SIMBOLIZAÇÃO (ELF ou, sem símbolos, alvos das chamadas)
+// ============================================================
+namespace {
+
+std::string hex_addr(uint32_t addr)
+{
+    std::ostringstream s;
+    s << "0x" << std::hex << std::setw(8) << std::setfill('0') << addr;
+    return s.str();
+}
+
+/**
+ * @struct Symbolizer
+ * @brief Associa um endereço à função que o contém: o último símbolo
+ * com endereço <= addr (respeitando o tamanho, quando conhecido).
+ */
+struct Symbolizer {
+    std::vector<ImageSymbol> funcs; // Ordenados por endereço
+
+    int find(uint32_t addr) const {
+        auto it = std::upper_bound(funcs.begin(), funcs.end(), addr,
+                                   [](uint32_t a, const ImageSymbol& s) { return a < s.addr; });
+        if (it == funcs.begin()) return -1;
+        const ImageSymbol& s = *(it - 1);
+        if (s.size && addr - s.addr >= s.size) return -1;
+        return (int)(it - 1 - funcs.begin());
+    }
+
+    // Nome da função que contém 'addr' (ou o próprio endereço)
+    std::string function(uint32_t addr) const {
+        int i = find(addr);
+        return i < 0 ? hex_addr(addr) : funcs[i].name;
+    }
+
+    // "função+0xdesloc" (ou o próprio endereço)
+    std::string location(uint32_t addr) const {
+        int i = find(addr);
+        if (i < 0) return hex_addr(addr);
+        uint32_t off = addr - funcs[i].addr;
+        if (off == 0) return funcs[i].name;
+        std::ostringstream s;
+        s << funcs[i].name << "+0x" << std::hex << off;
+        return s.str();
+    }
+};
+
+// Nomes no formato dobrado não podem ter ';' nem espaços
+std::string folded_name(std::string name)
+{
+    for (char& c : name)
+        if (c == ';' || c == ' ') c = '_';
+    return name;
+}
+
+double percent(uint64_t part, uint64_t total)
+{
+    return total ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+} // namespace
+
+// ============================================================
+//  CONTAGEM
+// ============================================================
+Profiler::Profiler()
+    : slots(0), expected(1), outside(0), node(0), frame_count(0), depth(0), overflow(0)
+{
+    nodes.push_back({ MAIN_RAM_START, 0, 0 });
+}
+
+void Profiler::start(uint32_t ram_size, uint32_t entry, const std::vector<ImageSymbol>& symbols)
+{
+    slots = ram_size >> 1;
+    pages.clear();
+    pages.resize(((uint64_t)slots + PAGE_SLOTS - 1) >> PAGE_SLOT_SHIFT);
+    expected = 1;
+    outside = 0;
+    nodes.assign(1, { entry, 0, 0 });
+    children.clear();
+    node = 0;
+    frame_count = 0;
+    depth = 0;
+    overflow = 0;
+
+    // Entradas de funções: destino de chamada de cauda
+    for (const ImageSymbol& s : symbols) {
+        uint32_t slot = (s.addr - MAIN_RAM_START) >> 1;
+        if (!s.function || slot >= slots) continue;
+        Page* page = pages[slot >> PAGE_SLOT_SHIFT].get();
+        if (!page) page = new_page(slot);
+        page->info[slot & PAGE_SLOT_MASK] |= INFO_FUNC;
+    }
+}
+
+Profiler::Page* Profiler::new_page(uint32_t slot)
+{
+    std::unique_ptr<Page>& page = pages[slot >> PAGE_SLOT_SHIFT];
+    page.reset(new Page());
+    return page.get();
+}
+
+uint64_t Profiler::instructions() const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) total += self_count(i);
+    return total;
+}
+
+// ============================================================
+//  PILHA DE CHAMADAS (JAL/JALR, ECALL/interrupções/MRET)
+// ============================================================
+static bool is_link(uint8_t r) { return r == 1 || r == 5; } // ra / t0
+
+void Profiler::transfer(const DecodedInstr& d, uint32_t target)
+{
+    switch (d.op) {
+    case OP_JAL:
+        if (is_link(d.rd)) call(target);
+        else if (is_function(target)) tail_call(target);
+        break;
+    case OP_JALR:
+        if (is_link(d.rd)) {
+            // rs1 e rd de ligação diferentes: retorna e chama (corrotina)
+            if (is_link(d.rs1) && d.rs1 != d.rd) ret();
+            call(target);
+        } else if (is_link(d.rs1)) {
+            ret();
+        } else if (is_function(target)) {
+            tail_call(target);
+        }
+        break;
+    case OP_ECALL:
+        call(target); // Tratador de trap
+        break;
+    case OP_MRET:
+        ret();
+        break;
+    default:
+        break;
+    }
+}
+
+void Profiler::interrupt(uint32_t target)
+{
+    expected = 1; // O tratador começa um bloco
+    call(target);
+}
+
+void Profiler::call(uint32_t target)
+{
+    if (depth >= MAX_DEPTH) {
+        overflow++;
+        return;
+    }
+    leave_frame();
+    uint64_t key = ((uint64_t)node << 32) | target;
+    auto it = children.find(key);
+    if (it == children.end()) {
+        nodes.push_back({ target, node, 0 });
+        it = children.emplace(key, (uint32_t)(nodes.size() - 1)).first;
+    }
+    node = it->second;
+    depth++;
+}
+
+// Salto para o início de uma função (STT_FUNC): troca o quadro atual
+void Profiler::tail_call(uint32_t target)
+{
+    if (overflow) return;
+    if (depth > 0) {
+        leave_frame();
+        node = nodes[node].parent;
+        depth--;
+    }
+    call(target);
+}
+
+bool Profiler::is_function(uint32_t addr) const
+{
+    uint32_t slot = (addr - MAIN_RAM_START) >> 1;
+    if (slot >= slots) return false;
+    const Page* page = pages[slot >> PAGE_SLOT_SHIFT].get();
+    return page && (page->info[slot & PAGE_SLOT_MASK] & INFO_FUNC);
+}
+
+void Profiler::ret()
+{
+    if (overflow) {
+        overflow--;
+    } else if (depth > 0) {
+        leave_frame();
+        node = nodes[node].parent;
+        depth--;
+    }
+    // Retorno sem chamada correspondente (ex.: da função raiz): ignorado
+}
+
+// ============================================================
+//  RELATÓRIOS
+// ============================================================
+void Profiler::write_report(std::ostream& out, const std::vector<ImageSymbol>& symbols, size_t top) const
+{
+    // Sem símbolos do ELF, as funções são os alvos das chamadas (e a raiz)
+    Symbolizer sym;
+    sym.funcs = symbols;
+    if (sym.funcs.empty()) {
+        for (const CallNode& n : nodes) sym.funcs.push_back({ n.func, 0, hex_addr(n.func), true });
+        std::sort(sym.funcs.begin(), sym.funcs.end(),
+                  [](const ImageSymbol& a, const ImageSymbol& b) { return a.addr < b.addr; });
+        sym.funcs.erase(std::unique(sym.funcs.begin(), sym.funcs.end(),
+                                    [](const ImageSymbol& a, const ImageSymbol& b) { return a.addr == b.addr; }),
+                        sym.funcs.end());
+    }
+
+    uint64_t total = instructions();
+
+    // 1. Blocos básicos: instruções contíguas a partir de cada início de
+    //    bloco; o exclusivo de cada função sai da mesma varredura
+    struct Block {
+        uint32_t start;
+        uint32_t instrs;
+        uint64_t execs;  // Execuções da primeira instrução
+        uint64_t weight; // Instruções executadas no bloco
+    };
+    std::vector<Block> blocks;
+    std::map<std::string, uint64_t> self;
+    uint32_t block_end = 0;
+    for (size_t p = 0; p < pages.size(); ++p) {
+        const Page* page = pages[p].get();
+        if (!page) continue;
+        for (uint32_t i = 0; i < PAGE_SLOTS; ++i) {
+            if (!page->hits[i]) continue;
+            uint32_t addr = MAIN_RAM_START + (((uint32_t)p << PAGE_SLOT_SHIFT) + i) * 2;
+            if ((page->info[i] & INFO_LEADER) || blocks.empty() || addr != block_end)
+                blocks.push_back({ addr, 0, page->hits[i], 0 });
+            blocks.back().instrs++;
+            blocks.back().weight += page->hits[i];
+            block_end = addr + (page->info[i] & INFO_LEN_MASK);
+            self[sym.function(addr)] += page->hits[i];
+        }
+    }
+    if (outside) self["[fora da RAM]"] += outside;
+
+    // 2. Inclusivo: total de cada nó da árvore (os filhos vêm sempre
+    //    depois do pai), contado uma vez só em recursões
+    std::vector<uint64_t> subtree(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;) {
+        subtree[i] += self_count(i);
+        if (i) subtree[nodes[i].parent] += subtree[i];
+    }
+    std::map<std::string, uint64_t> inclusive;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        std::string name = sym.function(nodes[i].func);
+        bool recursive = false;
+        for (size_t a = i; a && !recursive;) {
+            a = nodes[a].parent;
+            recursive = sym.function(nodes[a].func) == name;
+        }
+        if (!recursive) inclusive[name] += subtree[i];
+    }
+
+    out << "Instruções: " << total;
+    if (outside) out << " (" << outside << " fora da RAM)";
+    out << " | Blocos básicos: " << blocks.size() << " | Nós da árvore de chamadas: " << nodes.size() << "\n";
+    out << "Símbolos: " << (symbols.empty() ? "nenhum (funções = alvos das chamadas)" : "tabela do ELF") << "\n";
+
+    std::vector<std::pair<std::string, uint64_t>> funcs(self.begin(), self.end());
+    for (const auto& f : inclusive)
+        if (!self.count(f.first)) funcs.push_back({ f.first, 0 });
+    std::stable_sort(funcs.begin(), funcs.end(),
+                     [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+                         return a.second > b.second;
+                     });
+
+    out << "\n--- FUNÇÕES (exclusivo: na própria função; inclusivo: com as chamadas) ---\n";
+    out << "  excl. %    exclusivo  incl. %    inclusivo  função\n";
+    out << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < funcs.size() && i < top; ++i) {
+        auto it = inclusive.find(funcs[i].first);
+        uint64_t incl = it == inclusive.end() ? 0 : it->second;
+        out << std::setw(8) << percent(funcs[i].second, total) << "% " << std::setw(12) << funcs[i].second
+            << std::setw(8) << percent(incl, total) << "% " << std::setw(12) << incl
+            << "  " << funcs[i].first << "\n";
+    }
+
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [](const Block& a, const Block& b) { return a.weight > b.weight; });
+    out << "\n--- BLOCOS BÁSICOS MAIS QUENTES ---\n";
+    out << "        %   instruções    execuções  instr  endereço    local\n";
+    for (size_t i = 0; i < blocks.size() && i < top; ++i) {
+        const Block& b = blocks[i];
+        out << std::setw(8) << percent(b.weight, total) << "% " << std::setw(12) << b.weight
+            << " " << std::setw(12) << b.execs << " " << std::setw(6) << b.instrs
+            << "  " << hex_addr(b.start) << "  " << sym.location(b.start) << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+void Profiler::write_folded(std::ostream& out, const std::vector<ImageSymbol>& symbols) const
+{
+    Symbolizer sym;
+    sym.funcs = symbols;
+
+    // Caminho de cada nó (o pai sempre antes do filho); pilhas iguais
+    // depois da simbolização são somadas
+    std::vector<std::string> path(nodes.size());
+    std::map<std::string, uint64_t> stacks;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        std::string name = folded_name(sym.location(nodes[i].func));
+        path[i] = i ? path[nodes[i].parent] + ";" + name : name;
+        if (self_count(i)) stacks[path[i]] += self_count(i);
+    }
+    for (const auto& s : stacks) out << s.first << " " << s.second << "\n";
+}
@@ -0,0 +1,117 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "icache.h" // DecodedInstr / OpId
+#include "loader.h" // ImageSymbol
+#include "ram.h"    // MAIN_RAM_START
+
+/**
+ * @class Profiler
+ * @brief Perfil do programa convidado (--profile): contagem exata de
+ * execuções por PC e uma pilha de chamadas "sombra" montada a partir dos
+ * JAL/JALR.
+ *
+ * Os contadores são indexados por (pc - MAIN_RAM_START) >> 1 (meia
+ * palavra, por causa da extensão C) e alocados por página de 4 KB na
+ * primeira execução dela, então uma RAM grande não custa nada. Cada
+ * contador guarda ainda o tamanho da instrução e se ela é o início de um
+ * bloco básico (alcançada por desvio ou depois de um), o que basta para
+ * remontar os blocos no relatório.
+ *
+ * Chamadas e retornos seguem a convenção de ligação do RISC-V: JAL/JALR
+ * com rd = ra/t0 é chamada, JALR x0 com rs1 = ra/t0 é retorno. ECALL
+ * entra no tratador de trap como se fosse uma chamada e MRET sai dele.
+ * Um salto sem ligação ("j f", "jr t1") para o início de uma função do
+ * ELF (STT_FUNC) é chamada de cauda e troca o quadro atual; sem símbolos,
+ * fica no quadro de quem saltou.
+ */
+class Profiler {
+public:
+    static const int MAX_DEPTH = 512; // Além disso, as chamadas só são contadas
+
+    Profiler();
+
+    // Zera o perfil; 'entry' é a função raiz da pilha de chamadas e
+    // 'symbols' (do ELF, pode ser vazio) marca as entradas de funções
+    void start(uint32_t ram_size, uint32_t entry, const std::vector<ImageSymbol>& symbols);
+
+    // Uma instrução em 'pc' (chamado antes de executá-la)
+    void count(uint32_t pc, const DecodedInstr& d) {
+        uint32_t slot = (pc - MAIN_RAM_START) >> 1;
+        if (slot < slots) {
+            Page* page = pages[slot >> PAGE_SLOT_SHIFT].get();
+            if (!page) page = new_page(slot);
+            uint32_t i = slot & PAGE_SLOT_MASK;
+            page->hits[i]++;
+            page->info[i] |= d.len | (pc != expected ? INFO_LEADER : 0);
+        } else {
+            outside++;
+        }
+        // Desvios e instruções de SISTEMA fecham o bloco (como em block.cpp)
+        expected = (d.op >= OP_BEQ && d.op <= OP_WFI) ? 1 : pc + d.len;
+        frame_count++;
+    }
+
+    // JAL/JALR/ECALL/MRET já executada; 'target' é o novo PC
+    void transfer(const DecodedInstr& d, uint32_t target);
+    // Interrupção atendida: chama o tratador em 'target' (o MRET retorna)
+    void interrupt(uint32_t target);
+
+    uint64_t instructions() const; // Total contado (inclusive fora da RAM)
+
+    // Funções (exclusivo/inclusivo) e blocos básicos mais quentes
+    void write_report(std::ostream& out, const std::vector<ImageSymbol>& symbols, size_t top) const;
+    // Pilhas "dobradas" (uma linha "f;g;h N" por pilha), para flamegraph.pl
+    void write_folded(std::ostream& out, const std::vector<ImageSymbol>& symbols) const;
+
+private:
+    static const uint32_t PAGE_SLOT_SHIFT = 11; // 2048 meias palavras = 4 KB
+    static const uint32_t PAGE_SLOTS = 1u << PAGE_SLOT_SHIFT;
+    static const uint32_t PAGE_SLOT_MASK = PAGE_SLOTS - 1;
+    static const uint8_t INFO_LEADER = 0x80;    // Início de bloco básico
+    static const uint8_t INFO_FUNC = 0x40;      // Entrada de função (STT_FUNC)
+    static const uint8_t INFO_LEN_MASK = 0x06;  // 2 ou 4 bytes
+
+    struct Page {
+        uint64_t hits[PAGE_SLOTS];
+        uint8_t info[PAGE_SLOTS]; // Tamanho da instrução | INFO_LEADER | INFO_FUNC
+    };
+
+    /**
+     * @struct CallNode
+     * @brief Nó da árvore de chamadas: a função chamada (endereço de
+     * entrada) sob o nó pai, com as instruções executadas nela.
+     */
+    struct CallNode {
+        uint32_t func;
+        uint32_t parent;
+        uint64_t self;
+    };
+
+    uint32_t slots; // Meias palavras cobertas a partir de MAIN_RAM_START
+    std::vector<std::unique_ptr<Page>> pages;
+    uint32_t expected; // PC do fall-through da última instrução (1 = nenhum)
+    uint64_t outside;  // Instruções fora da RAM (sem contador por PC)
+
+    std::vector<CallNode> nodes;
+    std::unordered_map<uint64_t, uint32_t> children; // (pai << 32) | função -> nó
+    uint32_t node;     // Quadro atual
+    uint64_t frame_count; // Instruções do quadro atual ainda não somadas ao nó
+    int depth;
+    uint64_t overflow; // Chamadas além de MAX_DEPTH ainda sem retorno
+
+    Page* new_page(uint32_t slot);
+    uint64_t self_count(size_t i) const { return nodes[i].self + (i == node ? frame_count : 0); }
+    void leave_frame() { nodes[node].self += frame_count; frame_count = 0; }
+    void call(uint32_t target);
+    void tail_call(uint32_t target);
+    void ret();
+    bool is_function(uint32_t addr) const;
+};
+
+#endif // PROFILE_H
@@ -1,29 +1,165 @@
 #include "ram.h"
+#include "bus.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define RISCV_HAVE_MMAP 1
+#endif
+
 // ============================================================
 //  MAIN RAM
 // ============================================================
-MainRAM::MainRAM() {
-    memory.resize(MAIN_RAM_SIZE, 0);
-    std::cout << "[RAM] Módulo MainRAM (" << (MAIN_RAM_SIZE / 1024)
-              << " KB) criado.\n";
+MainRAM::MainRAM(uint32_t size, bool huge_pages)
+    : memory(nullptr),
+      memory_size(0),
+      os_mapped(false),
+      hugetlb(false)
+{
+    if (size == 0 || size > MAIN_RAM_MAX_SIZE) size = MAIN_RAM_SIZE;
+    memory_size = (uint32_t)(((uint64_t)size + 0xFFF) & ~(uint64_t)0xFFF);
+
+#if defined(_WIN32)
+    DWORD flags = MEM_RESERVE | MEM_COMMIT;
+    if (huge_pages && GetLargePageMinimum() && memory_size % GetLargePageMinimum() == 0)
+        memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, memory_size, flags | MEM_LARGE_PAGES, PAGE_READWRITE));
+    if (!memory)
+        memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, memory_size, flags, PAGE_READWRITE));
+    os_mapped = (memory != nullptr);
+#elif defined(RISCV_HAVE_MMAP)
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Páginas de 2 MB reservadas pelo SO; se não houver, cai no mmap comum
+    if (huge_pages && memory_size % (2u << 20) == 0) {
+        p = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0); // Sem NORESERVE: falha já aqui se faltar
+        hugetlb = (p != MAP_FAILED);
+    }
+#endif
+    if (p == MAP_FAILED)
+        p = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p != MAP_FAILED) {
+        memory = static_cast<uint8_t*>(p);
+        os_mapped = true;
+#ifdef MADV_HUGEPAGE
+        if (huge_pages && !hugetlb) madvise(memory, memory_size, MADV_HUGEPAGE); // THP
+#endif
+    }
+#endif
+    if (!memory)
+        memory = static_cast<uint8_t*>(std::calloc(memory_size, 1));
+    if (!memory) {
+        std::cerr << "[MainRAM] ERRO FATAL: Sem memória para " << (memory_size / 1024) << " KB.\n";
+        std::abort();
+    }
+
+    written.assign((memory_size / 4096 + 63) / 64, 0);
+    dirty.assign(written.size(), 0);
+
+    TRACE(TRACE_SUMMARY, "[RAM] Módulo MainRAM (" << (memory_size / 1024)
+              << " KB) criado.\n");
+}
+
+MainRAM::~MainRAM() {
+    if (!os_mapped) {
+        std::free(memory);
+        return;
+    }
+#if defined(_WIN32)
+    VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(RISCV_HAVE_MMAP)
+    munmap(memory, memory_size);
+#endif
+}
+
+// Zera só as páginas escritas desde o último 'reset'. Se forem mais de
+// 1/4 da RAM, devolve tudo ao SO: o próximo acesso recebe uma página
+// zerada e só as páginas realmente tocadas depois custam algo.
+void MainRAM::reset() {
+    uint32_t pages = dirtyPages();
+    bool released = false;
+    if (pages > memory_size / 4096 / 4) {
+#if defined(_WIN32)
+        released = os_mapped &&
+            VirtualFree(memory, memory_size, MEM_DECOMMIT) &&
+            VirtualAlloc(memory, memory_size, MEM_COMMIT, PAGE_READWRITE);
+#elif defined(RISCV_HAVE_MMAP)
+        released = os_mapped && !hugetlb && madvise(memory, memory_size, MADV_DONTNEED) == 0;
+#endif
+        if (!released) std::memset(memory, 0, memory_size);
+    } else if (pages) {
+        std::vector<uint32_t> list;
+        dirtyPageList(list, false);
+        for (uint32_t page : list)
+            std::memset(memory + (size_t)page * 4096, 0, 4096);
+    }
+    std::fill(written.begin(), written.end(), 0);
+    std::fill(dirty.begin(), dirty.end(), 0);
+}
+
+// ============================================================
+//  PÁGINAS SUJAS
+// ============================================================
+void MainRAM::markDirtyRange(uint32_t offset, uint32_t length) {
+    if (length == 0 || offset >= memory_size) return;
+    uint32_t last = (uint32_t)std::min<uint64_t>((uint64_t)offset + length - 1, memory_size - 1);
+    for (uint32_t page = offset / 4096; page <= last / 4096; ++page)
+        markDirty(page);
+}
+
+void MainRAM::checkpoint() {
+    for (size_t i = 0; i < written.size(); ++i) {
+        dirty[i] |= written[i];
+        written[i] = 0;
+    }
+}
+
+uint32_t MainRAM::dirtyPages() const {
+    uint32_t count = 0;
+    for (size_t i = 0; i < written.size(); ++i)
+        count += (uint32_t)__builtin_popcountll(written[i] | dirty[i]);
+    return count;
+}
+
+uint32_t MainRAM::writtenPages() const {
+    uint32_t count = 0;
+    for (uint64_t bits : written)
+        count += (uint32_t)__builtin_popcountll(bits);
+    return count;
+}
+
+void MainRAM::dirtyPageList(std::vector<uint32_t>& pages, bool since_checkpoint) const {
+    pages.clear();
+    for (size_t i = 0; i < written.size(); ++i) {
+        uint64_t bits = since_checkpoint ? written[i] : (written[i] | dirty[i]);
+        while (bits) {
+            pages.push_back((uint32_t)(i * 64 + __builtin_ctzll(bits)));
+            bits &= bits - 1;
+        }
+    }
 }
 
 uint8_t MainRAM::readByte(uint32_t local_addr) {
-    if (local_addr < memory.size())
+    if (local_addr < memory_size)
         return memory[local_addr];
-    std::cerr << "[MainRAM] ERRO: Leitura fora dos limites (0x"
+    log_err() << "[MainRAM] ERRO: Leitura fora dos limites (0x"
               << std::hex << local_addr << ")\n";
     return 0;
 }
 
 void MainRAM::writeByte(uint32_t local_addr, uint8_t data) {
-    if (local_addr < memory.size())
+    if (local_addr < memory_size)
         memory[local_addr] = data;
     else
-        std::cerr << "[MainRAM] ERRO: Escrita fora dos limites (0x"
+        log_err() << "[MainRAM] ERRO: Escrita fora dos limites (0x"
                   << std::hex << local_addr << ")\n";
 }
 
@@ -38,54 +174,145 @@ void MainRAM::writeByte(uint32_t local_addr, uint8_t data) {
 Peripherals::Peripherals()
     : simulation_should_halt(false),
       test_result(0),
-      tohost_word(0)
+      tohost_offset(LOCAL_TOHOST_ADDR),
+      fromhost_offset(LOCAL_FROMHOST_ADDR),
+      tohost_word(0),
+      fromhost_word(0),
+      request_pending(false),
+      backing_ram(nullptr),
+      backing(nullptr),
+      backing_page(0)
 {
-    std::cout << "[E/S] Módulo de Periféricos (1 KB) criado.\n";
+    TRACE(TRACE_SUMMARY, "[E/S] Módulo de Periféricos (1 KB) criado.\n");
+}
+
+void Peripherals::reset() {
+    simulation_should_halt = false;
+    test_result = 0;
+    tohost_offset = LOCAL_TOHOST_ADDR;
+    fromhost_offset = LOCAL_FROMHOST_ADDR;
+    tohost_word = 0;
+    fromhost_word = 0;
+    request_pending = false;
+    backing_ram = nullptr;
+    backing = nullptr;
+    clint.reset();
+    htif.reset();
+    uart.reset();
+}
+
+void Peripherals::backWithRam(MainRAM& ram, uint32_t page_addr) {
+    backing_ram = &ram;
+    backing = ram.data() + (page_addr - MAIN_RAM_START);
+    backing_page = (page_addr - MAIN_RAM_START) >> 12;
 }
 
 // --- Leitura de Byte ---
 // (Lê o byte correspondente da palavra 'tohost' interna - Little-Endian)
 uint8_t Peripherals::readByte(uint32_t local_addr) {
-    if (local_addr >= LOCAL_TOHOST_ADDR && local_addr <= LOCAL_TOHOST_ADDR + 3) {
-        uint32_t byte_offset = local_addr - LOCAL_TOHOST_ADDR;
+    if (local_addr >= tohost_offset && local_addr <= tohost_offset + 3) {
+        uint32_t byte_offset = local_addr - tohost_offset;
         uint32_t shift = byte_offset * 8;
         return static_cast<uint8_t>((tohost_word >> shift) & 0xFF);
     }
-    return 0;
+    if (inFromhost(local_addr)) {
+        return static_cast<uint8_t>(fromhost_word >> ((local_addr - fromhost_offset) * 8));
+    }
+    return backing ? backing[local_addr] : 0;
 }
 
 // --- Escrita de Byte ---
 // (Monta a palavra 'tohost' interna - Little-Endian)
 void Peripherals::writeByte(uint32_t local_addr, uint8_t data) {
-    if (local_addr >= LOCAL_TOHOST_ADDR && local_addr <= LOCAL_TOHOST_ADDR + 3) {
+    if (local_addr >= tohost_offset && local_addr <= tohost_offset + 3) {
 
-        uint32_t byte_offset = local_addr - LOCAL_TOHOST_ADDR;
+        uint32_t byte_offset = local_addr - tohost_offset;
         uint32_t shift = byte_offset * 8;
 
         // Limpa o byte antigo e insere o novo byte na posição correta
         tohost_word = (tohost_word & ~(0xFF << shift)) | (static_cast<uint32_t>(data) << shift);
 
         // A simulação NÃO para em uma escrita de byte.
+    } else if (backing && !inFromhost(local_addr)) {
+        backing[local_addr] = data;
+        backing_ram->markDirty(backing_page);
     }
 }
 
 // --- Leitura de Palavra ---
 uint32_t Peripherals::readWord(uint32_t local_addr) {
     // Acesso rápido à palavra tohost
-    if (local_addr == LOCAL_TOHOST_ADDR) {
+    if (local_addr == tohost_offset) {
         return tohost_word;
     }
-    return 0;
+    if (local_addr == fromhost_offset) {
+        return fromhost_word;
+    }
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 4; i++)
+        value |= (uint32_t)readByte(local_addr + i) << (8 * i);
+    return value;
 }
 
 // --- Escrita de Palavra ---
 void Peripherals::writeWord(uint32_t local_addr, uint32_t data) {
     // Só reage se for uma escrita no endereço base do 'tohost'
-    if (local_addr == LOCAL_TOHOST_ADDR) {
+    if (local_addr == tohost_offset) {
         tohost_word = data; // Armazena a palavra inteira
 
-        // A LÓGICA DE PARADA (HALT) ocorre aqui (escrita de palavra).
+        if (data & 1) {
+            // A LÓGICA DE PARADA (HALT) ocorre aqui (escrita de palavra).
+            simulation_should_halt = true;
+            test_result = tohost_word;
+        } else if (data) {
+            // Ponteiro para um pedido: atendido no ponto de serviço
+            request_pending.store(true, std::memory_order_release);
+        }
+    } else if (local_addr == fromhost_offset) {
+        fromhost_word = data; // O guest zera o 'fromhost' depois de ler a resposta
+    } else if (backing) {
+        for (uint32_t i = 0; i < 4; i++)
+            writeByte(local_addr + i, (data >> (8 * i)) & 0xFF);
+    }
+}
+
+// --- Pedido de Chamada de Sistema ---
+// 'exit' termina como um 'tohost' com o bit 0 ligado; um pedido fora da
+// RAM termina com o próprio ponteiro como resultado (FAIL)
+void Peripherals::serviceRequest(Bus& bus) {
+    if (!request_pending.exchange(false, std::memory_order_acq_rel)) return;
+    uint32_t block = tohost_word;
+    if (!htif.service(bus, block)) {
+        log_err() << "[HTIF] ERRO: Pedido fora da RAM (0x" << std::hex << block << std::dec << ")\n";
+        test_result = block;
+        simulation_should_halt = true;
+        return;
+    }
+    tohost_word = 0;
+    fromhost_word = 1;
+    if (htif.exited) {
+        test_result = (htif.exit_code << 1) | 1;
         simulation_should_halt = true;
-        test_result = tohost_word;
     }
 }
+
+// --- Interface MMIO ---
+// Palavras vão para readWord/writeWord (só a escrita de palavra no
+// 'tohost' para a simulação ou faz um pedido); bytes e meias-palavras,
+// byte a byte.
+uint32_t Peripherals::mmioRead(uint32_t offset, uint32_t size) {
+    if (size == 4) return readWord(offset);
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < size; i++)
+        value |= (uint32_t)readByte(offset + i) << (8 * i);
+    return value;
+}
+
+void Peripherals::mmioWrite(uint32_t offset, uint32_t data, uint32_t size) {
+    if (size == 4) {
+        writeWord(offset, data);
+        return;
+    }
+    for (uint32_t i = 0; i < size; i++)
+        writeByte(offset + i, (data >> (8 * i)) & 0xFF);
+}
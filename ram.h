@@ -1,14 +1,20 @@
 #ifndef RAM_H
 #define RAM_H
 
-#include <vector>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
+#include <vector>
+#include "mmio.h"
+#include "clint.h"
+#include "htif.h"
+#include "uart.h"
 
 // --- Definições do Mapa de Memória (ATUALIZADO PARA TESTES DE COMPLIANCE) ---
 const uint32_t MAIN_RAM_START = 0x80000000;
-const uint32_t MAIN_RAM_SIZE  = 0x80000;    // 512 KB
+const uint32_t MAIN_RAM_SIZE  = 0x80000;    // 512 KB (tamanho padrão, ver --ram-size)
 const uint32_t MAIN_RAM_END   = MAIN_RAM_START + MAIN_RAM_SIZE - 1;
+const uint32_t MAIN_RAM_MAX_SIZE = 0x80000000; // 2 GB: de MAIN_RAM_START até o fim do espaço
 
 // Não precisamos de VRAM para este teste
 const uint32_t VRAM_START = 0x00000; // Irrelevante
@@ -24,14 +30,60 @@ const uint32_t PERIPHERALS_END   = PERIPHERALS_START + PERIPHERALS_SIZE - 1;
 
 /**
  * @class MainRAM
+ * @brief RAM principal, reservada como memória anônima do SO (mmap /
+ * VirtualAlloc). As páginas só são zeradas pelo SO no primeiro acesso,
+ * então criar uma RAM de centenas de MB é O(1). A RAM sabe quais páginas
+ * de 4 KB foram escritas (bitmap atualizado pelo Bus), e 'reset' só zera
+ * essas; se forem muitas, devolve a RAM inteira ao SO (MADV_DONTNEED).
  */
 class MainRAM {
 public:
-    MainRAM();
+    // 'size' é arredondado para 4 KB; 'huge_pages' pede páginas grandes ao SO
+    explicit MainRAM(uint32_t size = MAIN_RAM_SIZE, bool huge_pages = false);
+    ~MainRAM();
+
     uint8_t readByte(uint32_t local_addr);
     void writeByte(uint32_t local_addr, uint8_t data);
+
+    // Ponteiro do host para o byte 0 da RAM (caminho rápido do Bus)
+    uint8_t* data() { return memory; }
+    const uint8_t* data() const { return memory; }
+    uint32_t size() const { return memory_size; }
+
+    void reset(); // Volta a RAM inteira para zero
+
+    // --- Páginas sujas (4 KB) ---
+    // O Bus chama 'markDirty' em toda escrita na RAM; quem escreve direto
+    // em data() (carregadores, snapshots) usa 'markDirtyRange'. Só a
+    // primeira escrita na página toca o bitmap, com um OR atômico: vários
+    // harts podem marcar páginas da mesma palavra ao mesmo tempo.
+    void markDirty(uint32_t page) {
+        uint64_t bit = 1ull << (page & 63);
+        if (!(__atomic_load_n(&written[page >> 6], __ATOMIC_RELAXED) & bit))
+            __atomic_fetch_or(&written[page >> 6], bit, __ATOMIC_RELAXED);
+    }
+    void markDirtyRange(uint32_t offset, uint32_t length);
+    // Fecha o intervalo atual: 'writtenPages' volta a zero (snapshots incrementais)
+    void checkpoint();
+    uint32_t dirtyPages() const;   // Páginas escritas desde o último 'reset'
+    uint32_t writtenPages() const; // ... desde o último 'checkpoint'
+    // Números das páginas sujas, em ordem crescente
+    void dirtyPageList(std::vector<uint32_t>& pages, bool since_checkpoint) const;
+
 private:
-    std::vector<uint8_t> memory;
+    uint8_t* memory;
+    uint32_t memory_size;
+    bool os_mapped; // false: alocação comum (plataforma sem mmap/VirtualAlloc)
+    bool hugetlb;   // Mapeada com MAP_HUGETLB (reset por memset)
+
+    // Bitmaps de páginas (1 bit cada): escritas desde o último checkpoint
+    // e escritas antes dele (desde o último 'reset'). Uma página que não
+    // está em nenhum dos dois é garantidamente zero.
+    std::vector<uint64_t> written;
+    std::vector<uint64_t> dirty;
+
+    MainRAM(const MainRAM&) = delete;
+    MainRAM& operator=(const MainRAM&) = delete;
 };
 
 /**
@@ -45,15 +97,41 @@ public:
 
 /**
  * @class Peripherals
+ * @brief Página do 'tohost'/'fromhost' (HTIF). Fica DENTRO da faixa da
+ * MainRAM e é mapeada por cima dela no Bus (ver Bus::mapMmio). Leva
+ * também o CLINT e a UART da máquina (mapeados à parte, em CLINT_START e
+ * UART_START).
+ *
+ * Uma palavra gravada no 'tohost' com o bit 0 ligado termina a simulação
+ * ('test_result' = a palavra: 1 = PASS, (n << 1) | 1 = FAIL do teste n).
+ * Qualquer outro valor diferente de zero é o endereço de um pedido de
+ * chamada de sistema (ver Htif): o hart que gravou o atende no próximo
+ * ponto de serviço (a escrita em MMIO força um), zera o 'tohost' e grava
+ * 1 no 'fromhost'. O guest espera o 'fromhost' e o zera, como no spike.
+ * Um pedido por vez: harts que fazem chamadas têm de se revezar.
+ *
+ * Num ELF o 'tohost' costuma dividir a página com outros dados (.data,
+ * .sdata): com 'backWithRam', só as palavras 'tohost' e 'fromhost' são
+ * interceptadas, e o resto da página lê e grava a MainRAM por baixo.
+ * Sem ela (imagens .hex/.bin), o resto da página lê 0 e descarta escritas.
  */
-class Peripherals {
+class Peripherals : public MmioDevice {
 public:
-    const static uint32_t LOCAL_TOHOST_ADDR = 0x0;
+    const static uint32_t LOCAL_TOHOST_ADDR = 0x0;    // Padrão (imagens .hex/.bin)
+    const static uint32_t LOCAL_FROMHOST_ADDR = 0x40; // Padrão: 64 bytes depois, como no riscv-tests
 
-    bool simulation_should_halt;
+    std::atomic<bool> simulation_should_halt; // Lido por todos os harts (SMP)
     uint32_t test_result;
+    uint32_t tohost_offset;   // Deslocamento do 'tohost' na página (símbolo do ELF)
+    uint32_t fromhost_offset; // Idem para o 'fromhost'
+    Clint clint;              // Timer e interrupções de software (todos os harts)
+    Htif htif;                // Chamadas de sistema do guest
+    Uart uart;                // Console do firmware (16550)
 
 Peripherals();
+    void reset(); // Estado inicial (reaproveita o módulo para outro programa)
+    // A página mapeada em 'page_addr' tem por baixo a RAM de 'ram' (ver acima)
+    void backWithRam(MainRAM& ram, uint32_t page_addr);
     uint8_t readByte(uint32_t local_addr);
     void writeByte(uint32_t local_addr, uint8_t data);
 
@@ -61,8 +139,30 @@ Peripherals();
     uint32_t readWord(uint32_t local_addr);
     void writeWord(uint32_t local_addr, uint32_t data);
 
+    // Interface MMIO (roteia para as funções acima)
+    uint32_t mmioRead(uint32_t offset, uint32_t size) override;
+    void mmioWrite(uint32_t offset, uint32_t data, uint32_t size) override;
+
+    // Pedido de chamada de sistema esperando um ponto de serviço
+    bool requestPending() const { return request_pending.load(std::memory_order_acquire); }
+    // Atende o pedido pela porta do hart (CPU::service_events)
+    void serviceRequest(Bus& bus);
+
+    // Estado interno do 'tohost'/'fromhost' (snapshot.cpp)
+    uint32_t getTohostWord() const { return tohost_word; }
+    void setTohostWord(uint32_t word) { tohost_word = word; request_pending = false; }
+    uint32_t getFromhostWord() const { return fromhost_word; }
+    void setFromhostWord(uint32_t word) { fromhost_word = word; }
+
 private:
     uint32_t tohost_word;
+    uint32_t fromhost_word;
+    std::atomic<bool> request_pending;
+    MainRAM* backing_ram;  // RAM por baixo da página (nullptr = nenhuma)
+    uint8_t* backing;      // Byte 0 da página na RAM
+    uint32_t backing_page; // Número da página na RAM (páginas sujas)
+
+    bool inFromhost(uint32_t local_addr) const { return local_addr - fromhost_offset < 4; }
 };
 
 #endif // RAM_H
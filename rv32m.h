@@ -0,0 +1,55 @@
+#ifndef RV32M_H
+#define RV32M_H
+
+#include <cstdint>
+
+// ============================================================
+//  RV32M – Multiplicação e divisão (opcode 0x33, funct7 = 0x01)
+// ============================================================
+// Usadas pelo 'execute', pelo motor threaded e pelo JIT, para que todos
+// os motores tenham exatamente a mesma semântica. A parte alta do produto
+// sai de uma única multiplicação de 64 bits do host. Divisão por zero e
+// estouro (INT32_MIN / -1) não geram trap, como manda a especificação:
+//   x / 0 = -1 (DIV) ou 0xFFFFFFFF (DIVU); x % 0 = x
+//   INT32_MIN / -1 = INT32_MIN; INT32_MIN % -1 = 0
+
+inline uint32_t rv_mulh(uint32_t a, uint32_t b)
+{
+    return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(int32_t)b) >> 32);
+}
+
+inline uint32_t rv_mulhsu(uint32_t a, uint32_t b)
+{
+    return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(uint64_t)b) >> 32);
+}
+
+inline uint32_t rv_mulhu(uint32_t a, uint32_t b)
+{
+    return (uint32_t)(((uint64_t)a * (uint64_t)b) >> 32);
+}
+
+inline uint32_t rv_div(uint32_t a, uint32_t b)
+{
+    if (b == 0) return 0xFFFFFFFF;
+    if (a == 0x80000000 && b == 0xFFFFFFFF) return a;
+    return (uint32_t)((int32_t)a / (int32_t)b);
+}
+
+inline uint32_t rv_divu(uint32_t a, uint32_t b)
+{
+    return b ? a / b : 0xFFFFFFFF;
+}
+
+inline uint32_t rv_rem(uint32_t a, uint32_t b)
+{
+    if (b == 0) return a;
+    if (a == 0x80000000 && b == 0xFFFFFFFF) return 0;
+    return (uint32_t)((int32_t)a % (int32_t)b);
+}
+
+inline uint32_t rv_remu(uint32_t a, uint32_t b)
+{
+    return b ? a % b : a;
+}
+
+#endif // RV32M_H
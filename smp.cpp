@@ -0,0 +1,101 @@
+#include "smp.h"
+#include "trace.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+// ============================================================
+//  BARREIRA DOS QUANTA
+// ============================================================
+void HartBarrier::arrive_and_wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t gen = generation;
+    if (++arrived == expected) {
+        arrived = 0;
+        generation++;
+        released.notify_all();
+        return;
+    }
+    released.wait(lock, [&] { return generation != gen; });
+}
+
+void HartBarrier::arrive_and_drop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    expected--;
+    if (expected > 0 && arrived == expected) {
+        arrived = 0;
+        generation++;
+        released.notify_all();
+    }
+}
+
+// ============================================================
+//  BOOT DE UM HART
+// ============================================================
+void boot_hart(CPU& cpu, uint32_t hartid, uint32_t harts, uint32_t entry)
+{
+    cpu.mhartid = hartid;
+    cpu.hart_count = harts;
+    cpu.regs[10] = hartid; // a0
+    cpu.regs[11] = harts;  // a1
+    if (cpu.pc != entry) cpu.setPC(entry);
+    cpu.running = true;
+    cpu.restart_cycles();
+}
+
+// ============================================================
+//  EXECUÇÃO DOS HARTS (Uma thread do host por hart)
+// ============================================================
+void run_smp(const std::vector<CPU*>& cpus, const std::vector<Bus*>& buses, int max_cycles,
+             SmpMode mode, int quantum)
+{
+    const size_t harts = cpus.size();
+    const std::atomic<bool>& halt = buses[0]->peripherals->simulation_should_halt;
+    Clint& clint = buses[0]->peripherals->clint;
+    std::vector<std::ostringstream> logs(harts);
+    HartBarrier barrier((int)harts);
+
+    auto hart_main = [&](size_t h) {
+        log_stream = &logs[h];
+        CPU& cpu = *cpus[h];
+        Bus& bus = *buses[h];
+        if (mode == SMP_FREE) {
+            cpu.run_slice(bus, max_cycles);
+            if (h < Clint::MAX_HARTS) clint.hart_wake[h] = clint.hart_ipi_wake[h] = ~0ull; // Não age mais
+        } else {
+            for (;;) {
+                int limit = (int)std::min<int64_t>(max_cycles, (int64_t)cpu.cycle_count + quantum);
+                cpu.run_slice(bus, limit);
+                if (!cpu.running || halt || cpu.cycle_count >= max_cycles) break;
+                barrier.arrive_and_wait();
+            }
+            barrier.arrive_and_drop();
+        }
+        log_stream = nullptr;
+    };
+
+    TRACE(TRACE_SUMMARY, "---[ INÍCIO DA EXECUÇÃO RISC-V (" << harts << " harts, "
+              << (mode == SMP_FREE ? "livres" : "quantum") << ") ]---\n");
+    // Harts livres publicam o próprio tempo (CPU::wait_for_interrupt): já
+    // antes de as threads começarem, para ninguém esperar em WFI à frente
+    // de um hart que ainda não rodou
+    for (size_t h = 0; h < harts; ++h) {
+        cpus[h]->free_running = (mode == SMP_FREE);
+        if (h < Clint::MAX_HARTS)
+            clint.hart_wake[h] = clint.hart_ipi_wake[h] = cpus[h]->free_running ? cpus[h]->time_now() : ~0ull;
+    }
+    std::vector<std::thread> threads;
+    for (size_t h = 1; h < harts; ++h) threads.emplace_back(hart_main, h);
+    std::ostream* caller_log = log_stream;
+    hart_main(0); // O hart 0 roda na própria thread chamadora
+    for (std::thread& t : threads) t.join();
+    log_stream = caller_log;
+
+    for (size_t h = 0; h < harts; ++h) {
+        std::string text = logs[h].str();
+        if (!text.empty()) log_out() << "[Hart " << h << "]\n" << text;
+    }
+    TRACE(TRACE_SUMMARY, "---[ FIM DA EXECUÇÃO RISC-V ]---\n");
+}
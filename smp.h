@@ -0,0 +1,67 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "bus.h"
+#include "cpu.h"
+
+// Escalonamento dos harts (cada um numa thread do host)
+enum SmpMode {
+    SMP_FREE,   // Cada hart roda livre até o fim
+    SMP_QUANTUM // Os harts se encontram numa barreira a cada 'quantum' ciclos
+};
+
+/**
+ * @struct Hart
+ * @brief Um hart além do 0: CPU própria e uma porta própria no barramento
+ * (mesma tabela de páginas, RAM e dispositivos do Bus principal). As
+ * escritas de um hart invalidam só as caches dele; os outros enxergam
+ * código novo depois do próprio FENCE.I, como manda a especificação.
+ */
+struct Hart {
+    Bus bus;
+    CPU cpu;
+
+    explicit Hart(Bus& primary) : bus(primary) {}
+};
+
+/**
+ * @class HartBarrier
+ * @brief Barreira do modo SMP_QUANTUM. Um hart que termina sai com
+ * 'arrive_and_drop', para que os outros não esperem por ele.
+ */
+class HartBarrier {
+public:
+    explicit HartBarrier(int count) : expected(count), arrived(0), generation(0) {}
+
+    void arrive_and_wait();
+    void arrive_and_drop();
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    int expected;
+    int arrived;
+    uint64_t generation;
+};
+
+/**
+ * @brief Prepara o hart 'hartid' para começar em 'entry': mhartid,
+ * hart_count e a convenção de boot do emulador (a0 = mhartid, a1 = número de harts),
+ * e zera os ciclos (os contadores continuam): depois dela o hart está pronto para o run_smp.
+ */
+void boot_hart(CPU& cpu, uint32_t hartid, uint32_t harts, uint32_t entry);
+
+/**
+ * @brief Roda 'cpus[i]' pela porta 'buses[i]', uma thread do host por
+ * hart, até o 'tohost' ser escrito ou todos os harts pararem. 'max_cycles'
+ * vale para cada hart. A saída de cada hart é juntada no log da thread
+ * chamadora, na ordem dos harts, depois que todos terminam.
+ */
+void run_smp(const std::vector<CPU*>& cpus, const std::vector<Bus*>& buses, int max_cycles,
+             SmpMode mode, int quantum);
+
+#endif // SMP_H
@@ -0,0 +1,369 @@
+#include "snapshot.h"
+#include "trace.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const uint32_t SNAP_PAGE_SIZE = 4096;
+const char SNAPSHOT_MAGIC[4] = { 'R', 'V', 'S', 'N' };
+const uint32_t SNAPSHOT_VERSION = 7; // 2: campo de flags (incremental); 3: contadores; 4: CLINT; 5: laços; 6: fromhost; 7: UART
+const uint32_t SNAPSHOT_INCREMENTAL = 1;
+
+// Página inteiramente zero? (compara de 8 em 8 bytes)
+bool page_is_zero(const uint8_t* page)
+{
+    for (uint32_t i = 0; i < SNAP_PAGE_SIZE; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, page + i, 8);
+        if (v) return false;
+    }
+    return true;
+}
+
+// ============================================================
+//  SERIALIZAÇÃO (Little-Endian, independente do host)
+// ============================================================
+void put32(std::vector<uint8_t>& out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+void put64(std::vector<uint8_t>& out, uint64_t v)
+{
+    put32(out, (uint32_t)v);
+    put32(out, (uint32_t)(v >> 32));
+}
+
+class Reader {
+public:
+    Reader(const uint8_t* p, const uint8_t* end) : p(p), end(end), ok(true) {}
+
+    uint32_t get32() {
+        if (end - p < 4) { ok = false; return 0; }
+        uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+        p += 4;
+        return v;
+    }
+    uint64_t get64() {
+        uint64_t lo = get32();
+        return lo | ((uint64_t)get32() << 32);
+    }
+    const uint8_t* take(size_t n) {
+        if ((size_t)(end - p) < n) { ok = false; return nullptr; }
+        const uint8_t* q = p;
+        p += n;
+        return q;
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+};
+
+} // namespace
+
+// ============================================================
+//  CAPTURA / RESTAURAÇÃO
+// ============================================================
+void take_snapshot(const CPU& cpu, MainRAM& ram, const Peripherals& peripherals,
+                   MachineSnapshot& snap, bool incremental)
+{
+    std::memcpy(snap.regs, cpu.regs, sizeof(snap.regs));
+    snap.pc = cpu.pc;
+    snap.running = cpu.running;
+    snap.cycle_count = cpu.cycle_count;
+    snap.mtvec = cpu.mtvec;
+    snap.mcause = cpu.mcause;
+    snap.mstatus = cpu.mstatus;
+    snap.mepc = cpu.mepc;
+    snap.mie = cpu.mie;
+    snap.medeleg = cpu.medeleg;
+    snap.mideleg = cpu.mideleg;
+    snap.pmpaddr0 = cpu.pmpaddr0;
+    snap.pmpcfg0 = cpu.pmpcfg0;
+    snap.satp = cpu.satp;
+    snap.mhartid = cpu.mhartid;
+    snap.cycle_base = cpu.cycle_base;
+    snap.idle_cycles = cpu.idle_cycles;
+    snap.mcycle_offset = cpu.mcycle_offset;
+    snap.minstret_offset = cpu.minstret_offset;
+    std::memcpy(snap.hpm_events, cpu.hpm_events, sizeof(snap.hpm_events));
+    std::memcpy(snap.mhpmevent, cpu.mhpmevent, sizeof(snap.mhpmevent));
+    std::memcpy(snap.hpm_offset, cpu.hpm_offset, sizeof(snap.hpm_offset));
+    snap.waiting = cpu.waiting;
+    snap.time_offset = cpu.time_offset;
+    snap.spin_skipped = cpu.spin_skipped;
+    snap.spin_pc = cpu.spin_pc;
+    snap.spin_backoff = cpu.spin_backoff;
+    snap.spin_countdown = cpu.spin_countdown;
+
+    snap.simulation_should_halt = peripherals.simulation_should_halt;
+    snap.test_result = peripherals.test_result;
+    snap.tohost_offset = peripherals.tohost_offset;
+    snap.tohost_word = peripherals.getTohostWord();
+    snap.fromhost_offset = peripherals.fromhost_offset;
+    snap.fromhost_word = peripherals.getFromhostWord();
+    const Uart& uart = peripherals.uart;
+    snap.uart_ier = uart.ier;
+    snap.uart_lcr = uart.lcr;
+    snap.uart_mcr = uart.mcr;
+    snap.uart_scr = uart.scr;
+    snap.uart_dll = uart.dll;
+    snap.uart_dlm = uart.dlm;
+    snap.uart_fcr = uart.fcr;
+    snap.mtime = peripherals.clint.mtime;
+    snap.mtimecmp = peripherals.clint.mtimecmp[0];
+    snap.msip = peripherals.clint.msip[0];
+
+    // Páginas fora da lista de sujas são zero. No incremental, uma página
+    // escrita com zeros ainda precisa ir: por baixo dela pode haver dados.
+    std::vector<uint32_t> pages;
+    ram.dirtyPageList(pages, incremental);
+    snap.incremental = incremental;
+    snap.ram_size = ram.size();
+    snap.page_index.clear();
+    snap.page_data.clear();
+    const uint8_t* memory = ram.data();
+    for (uint32_t page : pages) {
+        const uint8_t* src = memory + (size_t)page * SNAP_PAGE_SIZE;
+        if (!incremental && page_is_zero(src)) continue;
+        snap.page_index.push_back(page);
+        snap.page_data.insert(snap.page_data.end(), src, src + SNAP_PAGE_SIZE);
+    }
+    ram.checkpoint();
+}
+
+bool restore_snapshot(const MachineSnapshot& snap, CPU& cpu, MainRAM& ram, Peripherals& peripherals)
+{
+    if (snap.ram_size != ram.size()) {
+        log_err() << "[Snapshot] ERRO: RAM de " << (ram.size() / 1024) << " KB, snapshot de "
+                  << (snap.ram_size / 1024) << " KB.\n";
+        return false;
+    }
+
+    // Só mudam as páginas que podem não ser zero (as sujas) e as do
+    // snapshot: o que estava decodificado no resto continua valendo
+    std::vector<uint32_t> stale;
+    ram.dirtyPageList(stale, false);
+    stale.insert(stale.end(), snap.page_index.begin(), snap.page_index.end());
+    for (uint32_t page : stale) {
+        cpu.icache.invalidate_page(MAIN_RAM_START + page * SNAP_PAGE_SIZE);
+        cpu.blocks.invalidate_page(MAIN_RAM_START + page * SNAP_PAGE_SIZE);
+    }
+
+    if (!snap.incremental) ram.reset();
+    uint8_t* memory = ram.data();
+    for (size_t i = 0; i < snap.page_index.size(); ++i) {
+        uint32_t offset = snap.page_index[i] * SNAP_PAGE_SIZE;
+        std::memcpy(memory + offset, snap.page_data.data() + i * SNAP_PAGE_SIZE, SNAP_PAGE_SIZE);
+        ram.markDirtyRange(offset, SNAP_PAGE_SIZE);
+    }
+    ram.checkpoint(); // A RAM agora é o estado do snapshot
+
+    std::memcpy(cpu.regs, snap.regs, sizeof(cpu.regs));
+    cpu.pc = snap.pc;
+    cpu.running = snap.running;
+    cpu.cycle_count = snap.cycle_count;
+    cpu.mtvec = snap.mtvec;
+    cpu.mcause = snap.mcause;
+    cpu.mstatus = snap.mstatus;
+    cpu.mepc = snap.mepc;
+    cpu.mie = snap.mie;
+    cpu.medeleg = snap.medeleg;
+    cpu.mideleg = snap.mideleg;
+    cpu.pmpaddr0 = snap.pmpaddr0;
+    cpu.pmpcfg0 = snap.pmpcfg0;
+    cpu.satp = snap.satp;
+    cpu.mhartid = snap.mhartid;
+    cpu.cycle_base = snap.cycle_base;
+    cpu.idle_cycles = snap.idle_cycles;
+    cpu.mcycle_offset = snap.mcycle_offset;
+    cpu.minstret_offset = snap.minstret_offset;
+    std::memcpy(cpu.hpm_events, snap.hpm_events, sizeof(cpu.hpm_events));
+    std::memcpy(cpu.mhpmevent, snap.mhpmevent, sizeof(cpu.mhpmevent));
+    std::memcpy(cpu.hpm_offset, snap.hpm_offset, sizeof(cpu.hpm_offset));
+    cpu.waiting = snap.waiting;
+    cpu.time_offset = snap.time_offset;
+    cpu.spin_skipped = snap.spin_skipped;
+    cpu.spin_pc = snap.spin_pc;
+    cpu.spin_backoff = snap.spin_backoff;
+    cpu.spin_countdown = snap.spin_countdown;
+    cpu.time_generation = 0; // O 'reset' do CLINT abaixo zera a contagem
+
+    peripherals.simulation_should_halt = snap.simulation_should_halt;
+    peripherals.test_result = snap.test_result;
+    peripherals.tohost_offset = snap.tohost_offset;
+    peripherals.setTohostWord(snap.tohost_word);
+    peripherals.fromhost_offset = snap.fromhost_offset;
+    peripherals.setFromhostWord(snap.fromhost_word);
+    Uart& uart = peripherals.uart;
+    uart.ier = snap.uart_ier;
+    uart.lcr = snap.uart_lcr;
+    uart.mcr = snap.uart_mcr;
+    uart.scr = snap.uart_scr;
+    uart.dll = snap.uart_dll;
+    uart.dlm = snap.uart_dlm;
+    uart.fcr = snap.uart_fcr;
+    peripherals.clint.reset();
+    peripherals.clint.mtime = snap.mtime;
+    peripherals.clint.mtimecmp[0] = snap.mtimecmp;
+    peripherals.clint.msip[0] = snap.msip;
+    return true;
+}
+
+// ============================================================
+//  ARQUIVO
+// ============================================================
+//   "RVSN" | versão | flags | CPU (32 regs, pc, running, ciclos, 11 CSRs) |
+//   Contadores (base, ciclos em WFI, 2 deslocamentos, eventos, mhpmevent
+//   e deslocamentos dos mhpmcounter; 64 bits = duas palavras, a baixa
+//   primeiro) | Agendador (WFI, deslocamento do 'time', sondagem de
+//   laços sem efeitos) |
+//   Periféricos (halt, resultado, offset e palavra do 'tohost' e do
+//   'fromhost') | UART (IER, LCR, MCR, SCR, DLL, DLM, FCR: uma palavra cada) |
+//   CLINT (mtime, mtimecmp e msip do hart 0) |
+//   tamanho da RAM | nº de páginas | [página, 4 KB de dados] x N
+bool save_snapshot_file(const MachineSnapshot& snap, const std::string& filename)
+{
+    std::vector<uint8_t> out;
+    out.reserve(256 + snap.page_index.size() * (4 + SNAP_PAGE_SIZE));
+    out.insert(out.end(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4);
+    put32(out, SNAPSHOT_VERSION);
+    put32(out, snap.incremental ? SNAPSHOT_INCREMENTAL : 0);
+
+    for (int i = 0; i < 32; ++i) put32(out, snap.regs[i]);
+    put32(out, snap.pc);
+    put32(out, snap.running);
+    put32(out, (uint32_t)snap.cycle_count);
+    const uint32_t csrs[] = { snap.mtvec, snap.mcause, snap.mstatus, snap.mepc, snap.mie,
+                              snap.medeleg, snap.mideleg, snap.pmpaddr0, snap.pmpcfg0,
+                              snap.satp, snap.mhartid };
+    for (uint32_t csr : csrs) put32(out, csr);
+
+    put64(out, snap.cycle_base);
+    put64(out, snap.idle_cycles);
+    put64(out, snap.mcycle_offset);
+    put64(out, snap.minstret_offset);
+    for (uint64_t count : snap.hpm_events) put64(out, count);
+    for (uint32_t event : snap.mhpmevent) put32(out, event);
+    for (uint64_t offset : snap.hpm_offset) put64(out, offset);
+    put32(out, snap.waiting);
+    put64(out, snap.time_offset);
+    put64(out, snap.spin_skipped);
+    put32(out, snap.spin_pc);
+    put32(out, (uint32_t)snap.spin_backoff);
+    put32(out, (uint32_t)snap.spin_countdown);
+
+    put32(out, snap.simulation_should_halt);
+    put32(out, snap.test_result);
+    put32(out, snap.tohost_offset);
+    put32(out, snap.tohost_word);
+    put32(out, snap.fromhost_offset);
+    put32(out, snap.fromhost_word);
+    put32(out, snap.uart_ier);
+    put32(out, snap.uart_lcr);
+    put32(out, snap.uart_mcr);
+    put32(out, snap.uart_scr);
+    put32(out, snap.uart_dll);
+    put32(out, snap.uart_dlm);
+    put32(out, snap.uart_fcr);
+    put64(out, snap.mtime);
+    put64(out, snap.mtimecmp);
+    put32(out, snap.msip);
+
+    put32(out, snap.ram_size);
+    put32(out, (uint32_t)snap.page_index.size());
+    for (size_t i = 0; i < snap.page_index.size(); ++i) {
+        put32(out, snap.page_index[i]);
+        const uint8_t* page = snap.page_data.data() + i * SNAP_PAGE_SIZE;
+        out.insert(out.end(), page, page + SNAP_PAGE_SIZE);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size())) {
+        log_err() << "[Snapshot] ERRO: Não foi possível gravar " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_snapshot_file(const std::string& filename, MachineSnapshot& snap)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        log_err() << "[Snapshot] ERRO: Não foi possível abrir " << filename << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Reader r(in.data(), in.data() + in.size());
+    const uint8_t* magic = r.take(4);
+    if (!magic || std::memcmp(magic, SNAPSHOT_MAGIC, 4) != 0 || r.get32() != SNAPSHOT_VERSION) {
+        log_err() << "[Snapshot] ERRO: " << filename << " não é um snapshot (ou é de outra versão).\n";
+        return false;
+    }
+    snap.incremental = (r.get32() & SNAPSHOT_INCREMENTAL) != 0;
+
+    for (int i = 0; i < 32; ++i) snap.regs[i] = r.get32();
+    snap.pc = r.get32();
+    snap.running = r.get32() != 0;
+    snap.cycle_count = (int)r.get32();
+    uint32_t* csrs[] = { &snap.mtvec, &snap.mcause, &snap.mstatus, &snap.mepc, &snap.mie,
+                         &snap.medeleg, &snap.mideleg, &snap.pmpaddr0, &snap.pmpcfg0,
+                         &snap.satp, &snap.mhartid };
+    for (uint32_t* csr : csrs) *csr = r.get32();
+
+    snap.cycle_base = r.get64();
+    snap.idle_cycles = r.get64();
+    snap.mcycle_offset = r.get64();
+    snap.minstret_offset = r.get64();
+    for (uint64_t& count : snap.hpm_events) count = r.get64();
+    for (uint32_t& event : snap.mhpmevent) {
+        event = r.get32();
+        if (event >= HPM_EVENT_COUNT) r.ok = false;
+    }
+    for (uint64_t& offset : snap.hpm_offset) offset = r.get64();
+    snap.waiting = r.get32() != 0;
+    snap.time_offset = r.get64();
+    snap.spin_skipped = r.get64();
+    snap.spin_pc = r.get32();
+    snap.spin_backoff = (int)r.get32();
+    snap.spin_countdown = (int)r.get32();
+
+    snap.simulation_should_halt = r.get32() != 0;
+    snap.test_result = r.get32();
+    snap.tohost_offset = r.get32();
+    snap.tohost_word = r.get32();
+    snap.fromhost_offset = r.get32();
+    snap.fromhost_word = r.get32();
+    snap.uart_ier = (uint8_t)r.get32();
+    snap.uart_lcr = (uint8_t)r.get32();
+    snap.uart_mcr = (uint8_t)r.get32();
+    snap.uart_scr = (uint8_t)r.get32();
+    snap.uart_dll = (uint8_t)r.get32();
+    snap.uart_dlm = (uint8_t)r.get32();
+    snap.uart_fcr = (uint8_t)r.get32();
+    snap.mtime = r.get64();
+    snap.mtimecmp = r.get64();
+    snap.msip = r.get32() & 1;
+
+    snap.ram_size = r.get32();
+    uint32_t pages = r.get32();
+    snap.page_index.clear();
+    snap.page_data.clear();
+    for (uint32_t i = 0; i < pages && r.ok; ++i) {
+        uint32_t page = r.get32();
+        const uint8_t* data = r.take(SNAP_PAGE_SIZE);
+        if (!data || page >= snap.ram_size / SNAP_PAGE_SIZE) { r.ok = false; break; }
+        snap.page_index.push_back(page);
+        snap.page_data.insert(snap.page_data.end(), data, data + SNAP_PAGE_SIZE);
+    }
+
+    if (!r.ok) {
+        log_err() << "[Snapshot] ERRO: " << filename << " está truncado ou corrompido.\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu.h"
+#include "ram.h"
+
+/**
+ * @struct MachineSnapshot
+ * @brief Estado completo da máquina em um ponto entre duas instruções:
+ * CPU (registradores, PC, CSRs, ciclos e contadores), MainRAM e Periféricos.
+ *
+ * A RAM é guardada esparsa: só as páginas de 4 KB sujas (escritas desde o
+ * 'reset' da RAM) que não são inteiramente zero ('page_index' +
+ * 'page_data'). Um teste típico toca poucas páginas, então o snapshot de
+ * uma RAM de centenas de MB ocupa dezenas de KB e sai sem varrer a RAM.
+ *
+ * Um snapshot incremental guarda só as páginas escritas desde o snapshot
+ * anterior (o checkpoint da RAM) e só pode ser restaurado por cima do
+ * estado em que esse snapshot anterior foi tirado.
+ *
+ * O mapa de memória do Bus NÃO faz parte do snapshot: ele é configuração
+ * (montado pelo construtor e pelo carregador), e a restauração deve ser
+ * feita em uma máquina montada da mesma forma. Também ficam de fora os
+ * arquivos do host abertos pelo guest e a saída do console ainda no
+ * buffer (Htif e Uart): são do processo, não da máquina.
+ */
+struct MachineSnapshot {
+    // --- CPU ---
+    uint32_t regs[32];
+    uint32_t pc;
+    bool running;
+    int cycle_count;
+    uint32_t mtvec, mcause, mstatus, mepc, mie, medeleg, mideleg;
+    uint32_t pmpaddr0, pmpcfg0, satp, mhartid;
+    // Contadores (estado interno de CPU: base + deslocamentos)
+    uint64_t cycle_base, idle_cycles, mcycle_offset, minstret_offset;
+    uint64_t hpm_events[HPM_EVENT_COUNT];
+    uint32_t mhpmevent[CPU::HPM_COUNTERS];
+    uint64_t hpm_offset[CPU::HPM_COUNTERS];
+    // Agendador (parado em WFI), deslocamento do 'time' e sondagem de laços
+    bool waiting;
+    uint64_t time_offset;
+    uint64_t spin_skipped;
+    uint32_t spin_pc;
+    int spin_backoff, spin_countdown;
+
+    // --- Periféricos ---
+    bool simulation_should_halt;
+    uint32_t test_result;
+    uint32_t tohost_offset;
+    uint32_t tohost_word;
+    uint32_t fromhost_offset;
+    uint32_t fromhost_word;
+    // UART: registradores de configuração (a FIFO de recepção é do host)
+    uint8_t uart_ier, uart_lcr, uart_mcr, uart_scr, uart_dll, uart_dlm, uart_fcr;
+    // CLINT (o snapshot é de uma máquina de um hart: só o hart 0)
+    uint64_t mtime, mtimecmp;
+    uint32_t msip;
+
+    // --- MainRAM (esparsa) ---
+    bool incremental; // Só as páginas escritas desde o snapshot anterior
+    uint32_t ram_size;
+    std::vector<uint32_t> page_index; // Número da página (deslocamento / 4 KB)
+    std::vector<uint8_t>  page_data;  // page_index.size() * 4 KB, na mesma ordem
+
+    uint64_t bytes() const { return page_data.size(); }
+};
+
+/**
+ * @brief Captura o estado. Deve ser chamada com a CPU parada (fora de
+ * 'run'/'resume'), quando nenhuma instrução está pela metade. Marca um
+ * checkpoint na RAM: o próximo snapshot incremental parte daqui.
+ */
+void take_snapshot(const CPU& cpu, MainRAM& ram, const Peripherals& peripherals,
+                   MachineSnapshot& snap, bool incremental = false);
+
+/**
+ * @brief Devolve a máquina ao estado do snapshot. Num snapshot completo a
+ * RAM volta a zero pelo 'reset' (só as páginas sujas custam algo); nos
+ * dois tipos ela recebe as páginas guardadas. As caches de decodificação e
+ * de blocos da CPU perdem só as páginas que mudaram. Continue com CPU::resume.
+ * Falha se o tamanho da RAM diferir.
+ */
+bool restore_snapshot(const MachineSnapshot& snap, CPU& cpu, MainRAM& ram, Peripherals& peripherals);
+
+/**
+ * @brief Grava/lê o snapshot em um arquivo binário compacto ("RVSN",
+ * campos little-endian de 32 bits, seguidos das páginas guardadas).
+ */
+bool save_snapshot_file(const MachineSnapshot& snap, const std::string& filename);
+bool load_snapshot_file(const std::string& filename, MachineSnapshot& snap);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,44 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <iostream>
+
+// ============================================================
+//  NÍVEIS DE TRACE (Escolhidos em tempo de compilação)
+// ============================================================
+// O nível é definido com -DRISCV_TRACE_LEVEL=N. Como TRACE_LEVEL é
+// constexpr, os blocos de log acima do nível escolhido são descartados
+// pelo compilador: no build "off" o laço fetch/execute não contém
+// nenhum código de stream.
+enum TraceLevel {
+    TRACE_OFF     = 0, // Nenhum log (apenas resultados dos testes)
+    TRACE_SUMMARY = 1, // Banners dos módulos e resumo da execução
+    TRACE_INSTR   = 2, // + [FETCH]/[EXEC] de cada instrução
+    TRACE_MEM     = 3  // + detalhes de cada acesso à memória ("->")
+};
+
+#ifndef RISCV_TRACE_LEVEL
+#define RISCV_TRACE_LEVEL 1 // Padrão: somente o resumo
+#endif
+
+constexpr TraceLevel TRACE_LEVEL = static_cast<TraceLevel>(RISCV_TRACE_LEVEL);
+
+// ============================================================
+//  DESTINO DOS LOGS (Por thread)
+// ============================================================
+// Por padrão os logs vão para std::cout/std::cerr. No modo '-j N' cada
+// worker aponta 'log_stream' para o buffer do teste que está rodando,
+// então as saídas de testes paralelos não se misturam.
+inline thread_local std::ostream* log_stream = nullptr;
+
+inline std::ostream& log_out() { return log_stream ? *log_stream : std::cout; }
+inline std::ostream& log_err() { return log_stream ? *log_stream : std::cerr; }
+
+/**
+ * @brief Escreve 'expr' (uma cadeia de operator<<) se o nível estiver ativo.
+ * Ex.: TRACE(TRACE_INSTR, "[FETCH] PC: 0x" << std::hex << pc << "\n");
+ */
+#define TRACE(level, expr) \
+    do { if constexpr (TRACE_LEVEL >= (level)) { log_out() << expr; } } while (0)
+
+#endif // TRACE_H
@@ -0,0 +1,182 @@
+#include "uart.h"
+#include "trace.h"
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <unistd.h>
+#define RISCV_HAVE_POLL 1
+#endif
+
+// Bits dos registradores usados aqui
+static const uint8_t LCR_DLAB = 0x80; // Divisor nos endereços 0 e 1
+static const uint8_t MCR_LOOP = 0x10; // THR volta no RBR
+static const uint8_t LSR_DR   = 0x01; // Há dado no RBR
+static const uint8_t LSR_THRE = 0x20; // THR vazio
+static const uint8_t LSR_TEMT = 0x40; // Transmissor vazio
+static const uint8_t FCR_ENABLE   = 0x01;
+static const uint8_t FCR_CLEAR_RX = 0x02;
+static const uint8_t IIR_NONE       = 0x01; // Nenhuma interrupção pendente
+static const uint8_t IIR_FIFO       = 0xC0; // FIFOs habilitadas
+static const uint8_t MSR_CONNECTED  = 0xB0; // DCD, DSR e CTS ligados
+
+// Milissegundos do relógio monotônico do host
+static int64_t host_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Uart::Uart()
+    : quiet(false),
+      shared(false),
+      tx(TX_BUFFER),
+      input_fd(-1)
+{
+    reset();
+}
+
+Uart::~Uart()
+{
+    flush();
+}
+
+void Uart::reset()
+{
+    std::unique_lock<std::mutex> lock = guard();
+    ier = lcr = mcr = scr = fcr = 0;
+    dll = 1; // Divisor qualquer diferente de zero
+    dlm = 0;
+    tx_len = 0;
+    tx_since = 0;
+    rx_head = rx_count = 0;
+    input_fd = -1;
+    next_poll = 0;
+    tx_bytes = rx_bytes = 0;
+}
+
+void Uart::flush()
+{
+    std::unique_lock<std::mutex> lock = guard();
+    flush_locked();
+}
+
+void Uart::flush_locked()
+{
+    if (!tx_len) return;
+    if (!quiet) {
+        log_out().write(tx.data(), tx_len);
+        log_out().flush();
+    }
+    tx_len = 0;
+}
+
+// ============================================================
+//  PONTO DE SERVIÇO (hart 0)
+// ============================================================
+void Uart::poll(uint64_t cycles)
+{
+    next_poll = cycles + POLL_INTERVAL;
+    std::unique_lock<std::mutex> lock = guard();
+    if (tx_len && host_ms() - tx_since >= TX_FLUSH_MS) flush_locked();
+
+#ifdef RISCV_HAVE_POLL
+    if (input_fd < 0 || rx_count == RX_FIFO) return;
+    struct pollfd p = { input_fd, POLLIN, 0 };
+    if (::poll(&p, 1, 0) <= 0 || !(p.revents & (POLLIN | POLLHUP))) return;
+    uint8_t buf[RX_FIFO];
+    ssize_t got = ::read(input_fd, buf, RX_FIFO - rx_count);
+    if (got <= 0) {
+        input_fd = -1; // Fim da entrada (ou erro): o receptor fica vazio
+        return;
+    }
+    for (ssize_t i = 0; i < got; ++i)
+        rx[(rx_head + rx_count++) % RX_FIFO] = buf[i];
+    rx_bytes += (uint64_t)got;
+#endif
+}
+
+// ============================================================
+//  REGISTRADORES
+// ============================================================
+void Uart::transmit(uint8_t byte)
+{
+    if (mcr & MCR_LOOP) {
+        if (rx_count < RX_FIFO) rx[(rx_head + rx_count++) % RX_FIFO] = byte;
+        return;
+    }
+    if (!tx_len) tx_since = host_ms();
+    tx[tx_len++] = (char)byte;
+    tx_bytes++;
+    if (tx_len == TX_BUFFER) flush_locked();
+}
+
+uint8_t Uart::readRegister(uint32_t reg)
+{
+    switch (reg) {
+    case 0:
+        if (lcr & LCR_DLAB) return dll;
+        if (rx_count) {
+            uint8_t byte = rx[rx_head];
+            rx_head = (rx_head + 1) % RX_FIFO;
+            rx_count--;
+            return byte;
+        }
+        return 0;
+    case 1: return (lcr & LCR_DLAB) ? dlm : ier;
+    case 2: return IIR_NONE | ((fcr & FCR_ENABLE) ? IIR_FIFO : 0);
+    case 3: return lcr;
+    case 4: return mcr;
+    case 5: return LSR_THRE | LSR_TEMT | (rx_count ? LSR_DR : 0);
+    case 6: return MSR_CONNECTED;
+    case 7: return scr;
+    default: return 0;
+    }
+}
+
+void Uart::writeRegister(uint32_t reg, uint8_t value)
+{
+    switch (reg) {
+    case 0:
+        if (lcr & LCR_DLAB) dll = value;
+        else transmit(value);
+        break;
+    case 1:
+        if (lcr & LCR_DLAB) dlm = value;
+        else ier = value & 0x0F;
+        break;
+    case 2:
+        fcr = value & FCR_ENABLE;
+        if (value & FCR_CLEAR_RX) rx_head = rx_count = 0;
+        break;
+    case 3: lcr = value; break;
+    case 4: mcr = value & 0x1F; break;
+    case 7: scr = value; break;
+    default: break; // LSR e MSR são só de leitura
+    }
+}
+
+// ============================================================
+//  INTERFACE MMIO
+// ============================================================
+// Registradores de um byte nos deslocamentos 0 a 7; um acesso maior
+// atua no registrador do deslocamento (byte de baixo). São o caminho
+// quente do console: sem 'shared', nenhuma trava.
+uint32_t Uart::mmioRead(uint32_t offset, uint32_t size)
+{
+    (void)size;
+    if (!shared) return readRegister(offset);
+    std::lock_guard<std::mutex> lock(mutex);
+    return readRegister(offset);
+}
+
+void Uart::mmioWrite(uint32_t offset, uint32_t data, uint32_t size)
+{
+    (void)size;
+    if (!shared) {
+        writeRegister(offset, data & 0xFF);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    writeRegister(offset, data & 0xFF);
+}
@@ -0,0 +1,89 @@
+#ifndef UART_H
+#define UART_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "mmio.h"
+
+// UART 16550 no endereço usado pelo QEMU 'virt' (registradores de 1 byte)
+const uint32_t UART_START = 0x10000000;
+const uint32_t UART_SIZE  = 0x1000;
+
+/**
+ * @class Uart
+ * @brief UART compatível com o 16550 (console do firmware).
+ *
+ *   0 RBR (leitura) / THR (escrita)   DLL com LCR.DLAB
+ *   1 IER                             DLM com LCR.DLAB
+ *   2 IIR (leitura) / FCR (escrita)
+ *   3 LCR   4 MCR   5 LSR   6 MSR   7 SCR
+ *
+ * O transmissor nunca está ocupado (LSR.THRE e TEMT sempre ligados): cada
+ * byte do THR vai para um buffer do host, escrito no log em blocos quando
+ * passa de TX_BUFFER bytes ou quando fica TX_FLUSH_MS parado (conferido no
+ * ponto de serviço do agendador). Escrever na UART não força um ponto de
+ * serviço, então a linha reta da CPU não é interrompida a cada byte.
+ *
+ * O receptor tem a FIFO de 16 bytes do 16550, alimentada por um descritor
+ * do host (--uart-input: o stdin) sem bloquear: o hart 0 consulta o
+ * descritor a cada POLL_INTERVAL ciclos, num ponto de serviço, nunca por
+ * instrução. Não há PLIC: o IER é guardado, mas a UART não interrompe a
+ * CPU (o firmware consulta o LSR). Com MCR.LOOP, o THR volta no RBR.
+ */
+class Uart : public MmioDevice {
+public:
+    static const uint32_t TX_BUFFER = 64 * 1024;  // Bytes transmitidos antes de ir para o log
+    static const int TX_FLUSH_MS = 50;            // Buffer parado há mais que isso vai para o log
+    static const uint32_t RX_FIFO = 16;           // FIFO de recepção do 16550
+    static const uint64_t POLL_INTERVAL = 1u << 16; // Ciclos entre consultas ao host
+
+    // Registradores de configuração (sem efeito na transmissão; snapshot.cpp)
+    uint8_t ier, lcr, mcr, scr, dll, dlm, fcr;
+    bool quiet;          // Descarta a transmissão (reexecuções do --engine=check)
+    bool shared;         // Mais de um hart (--harts): acessos sob a trava
+    uint64_t tx_bytes;   // Bytes transmitidos (estatística)
+    uint64_t rx_bytes;   // Bytes recebidos do host (estatística)
+
+    Uart();
+    ~Uart();
+    void reset(); // Registradores, FIFO e buffer (sem entrada do host)
+
+    // Descritor do host que alimenta o receptor (-1 = nenhum)
+    void setInput(int fd) { input_fd = fd; }
+    // Ponto de serviço do hart 0: consulta a entrada e escreve o buffer
+    // parado, no máximo a cada POLL_INTERVAL ciclos
+    void service(uint64_t cycles) { if (cycles >= next_poll) poll(cycles); }
+    // Manda o buffer de transmissão para o log (fim do programa)
+    void flush();
+
+    uint32_t mmioRead(uint32_t offset, uint32_t size) override;
+    void mmioWrite(uint32_t offset, uint32_t data, uint32_t size) override;
+    bool serviceOnWrite() const override { return false; }
+
+private:
+    std::mutex mutex;        // Harts de threads diferentes (só com 'shared')
+    std::vector<char> tx;    // Transmitido e ainda não escrito no log (TX_BUFFER bytes)...
+    uint32_t tx_len;         // ... dos quais estes estão ocupados
+    int64_t tx_since;        // Quando o buffer deixou de estar vazio (ms do host)
+    uint8_t rx[RX_FIFO];     // FIFO de recepção (circular)
+    uint32_t rx_head, rx_count;
+    int input_fd;
+    uint64_t next_poll;
+
+    // Trava a UART se 'shared'; com um hart só, a trava custaria metade
+    // de cada acesso ao THR
+    std::unique_lock<std::mutex> guard() {
+        return shared ? std::unique_lock<std::mutex>(mutex) : std::unique_lock<std::mutex>();
+    }
+    void poll(uint64_t cycles);
+    void transmit(uint8_t byte);
+    uint8_t readRegister(uint32_t reg);
+    void writeRegister(uint32_t reg, uint8_t value);
+    void flush_locked();
+
+    Uart(const Uart&) = delete;
+    Uart& operator=(const Uart&) = delete;
+};
+
+#endif // UART_H